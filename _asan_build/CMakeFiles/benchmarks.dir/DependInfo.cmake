@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/bench/algorithm-benchmark.cpp" "CMakeFiles/benchmarks.dir/bench/algorithm-benchmark.cpp.o" "gcc" "CMakeFiles/benchmarks.dir/bench/algorithm-benchmark.cpp.o.d"
+  "/root/repo/bench/latency-benchmark.cpp" "CMakeFiles/benchmarks.dir/bench/latency-benchmark.cpp.o" "gcc" "CMakeFiles/benchmarks.dir/bench/latency-benchmark.cpp.o.d"
+  "/root/repo/bench/main.cpp" "CMakeFiles/benchmarks.dir/bench/main.cpp.o" "gcc" "CMakeFiles/benchmarks.dir/bench/main.cpp.o.d"
+  "/root/repo/bench/vector-benchmark.cpp" "CMakeFiles/benchmarks.dir/bench/vector-benchmark.cpp.o" "gcc" "CMakeFiles/benchmarks.dir/bench/vector-benchmark.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,17 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmarks.dir/bench/algorithm-benchmark.cpp.o"
+  "CMakeFiles/benchmarks.dir/bench/algorithm-benchmark.cpp.o.d"
+  "CMakeFiles/benchmarks.dir/bench/latency-benchmark.cpp.o"
+  "CMakeFiles/benchmarks.dir/bench/latency-benchmark.cpp.o.d"
+  "CMakeFiles/benchmarks.dir/bench/main.cpp.o"
+  "CMakeFiles/benchmarks.dir/bench/main.cpp.o.d"
+  "CMakeFiles/benchmarks.dir/bench/vector-benchmark.cpp.o"
+  "CMakeFiles/benchmarks.dir/bench/vector-benchmark.cpp.o.d"
+  "benchmarks"
+  "benchmarks.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/benchmarks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/buffer-registry-test.dir/test/buffer-registry-test.cpp.o"
+  "CMakeFiles/buffer-registry-test.dir/test/buffer-registry-test.cpp.o.d"
+  "buffer-registry-test"
+  "buffer-registry-test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/buffer-registry-test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/call-site-test.dir/test/call-site-test.cpp.o"
+  "CMakeFiles/call-site-test.dir/test/call-site-test.cpp.o.d"
+  "call-site-test"
+  "call-site-test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/call-site-test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
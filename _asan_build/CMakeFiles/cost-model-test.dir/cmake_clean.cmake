@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/cost-model-test.dir/test/alloc-tracker.cpp.o"
+  "CMakeFiles/cost-model-test.dir/test/alloc-tracker.cpp.o.d"
+  "CMakeFiles/cost-model-test.dir/test/cost-model-test.cpp.o"
+  "CMakeFiles/cost-model-test.dir/test/cost-model-test.cpp.o.d"
+  "cost-model-test"
+  "cost-model-test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/cost-model-test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
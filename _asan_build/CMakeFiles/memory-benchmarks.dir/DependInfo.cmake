@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/bench/main.cpp" "CMakeFiles/memory-benchmarks.dir/bench/main.cpp.o" "gcc" "CMakeFiles/memory-benchmarks.dir/bench/main.cpp.o.d"
+  "/root/repo/bench/memory-benchmark.cpp" "CMakeFiles/memory-benchmarks.dir/bench/memory-benchmark.cpp.o" "gcc" "CMakeFiles/memory-benchmarks.dir/bench/memory-benchmark.cpp.o.d"
+  "/root/repo/test/alloc-tracker.cpp" "CMakeFiles/memory-benchmarks.dir/test/alloc-tracker.cpp.o" "gcc" "CMakeFiles/memory-benchmarks.dir/test/alloc-tracker.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
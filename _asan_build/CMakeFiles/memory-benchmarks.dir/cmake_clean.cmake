@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/memory-benchmarks.dir/bench/main.cpp.o"
+  "CMakeFiles/memory-benchmarks.dir/bench/main.cpp.o.d"
+  "CMakeFiles/memory-benchmarks.dir/bench/memory-benchmark.cpp.o"
+  "CMakeFiles/memory-benchmarks.dir/bench/memory-benchmark.cpp.o.d"
+  "CMakeFiles/memory-benchmarks.dir/test/alloc-tracker.cpp.o"
+  "CMakeFiles/memory-benchmarks.dir/test/alloc-tracker.cpp.o.d"
+  "memory-benchmarks"
+  "memory-benchmarks.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/memory-benchmarks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/stats-test.dir/test/stats-test.cpp.o"
+  "CMakeFiles/stats-test.dir/test/stats-test.cpp.o.d"
+  "stats-test"
+  "stats-test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/stats-test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
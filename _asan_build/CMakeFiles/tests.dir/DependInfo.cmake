@@ -0,0 +1,35 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/test/algorithm-test.cpp" "CMakeFiles/tests.dir/test/algorithm-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/algorithm-test.cpp.o.d"
+  "/root/repo/test/async-unshare-test.cpp" "CMakeFiles/tests.dir/test/async-unshare-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/async-unshare-test.cpp.o.d"
+  "/root/repo/test/cow-test.cpp" "CMakeFiles/tests.dir/test/cow-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/cow-test.cpp.o.d"
+  "/root/repo/test/edit-plan-test.cpp" "CMakeFiles/tests.dir/test/edit-plan-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/edit-plan-test.cpp.o.d"
+  "/root/repo/test/external-buffer-test.cpp" "CMakeFiles/tests.dir/test/external-buffer-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/external-buffer-test.cpp.o.d"
+  "/root/repo/test/fused-algorithm-test.cpp" "CMakeFiles/tests.dir/test/fused-algorithm-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/fused-algorithm-test.cpp.o.d"
+  "/root/repo/test/incremental-growth-test.cpp" "CMakeFiles/tests.dir/test/incremental-growth-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/incremental-growth-test.cpp.o.d"
+  "/root/repo/test/no-copy-scope-test.cpp" "CMakeFiles/tests.dir/test/no-copy-scope-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/no-copy-scope-test.cpp.o.d"
+  "/root/repo/test/paged-cow-test.cpp" "CMakeFiles/tests.dir/test/paged-cow-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/paged-cow-test.cpp.o.d"
+  "/root/repo/test/parallel-copy-test.cpp" "CMakeFiles/tests.dir/test/parallel-copy-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/parallel-copy-test.cpp.o.d"
+  "/root/repo/test/performance-test.cpp" "CMakeFiles/tests.dir/test/performance-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/performance-test.cpp.o.d"
+  "/root/repo/test/serialization-test.cpp" "CMakeFiles/tests.dir/test/serialization-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/serialization-test.cpp.o.d"
+  "/root/repo/test/small-object-test.cpp" "CMakeFiles/tests.dir/test/small-object-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/small-object-test.cpp.o.d"
+  "/root/repo/test/streaming-copy-test.cpp" "CMakeFiles/tests.dir/test/streaming-copy-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/streaming-copy-test.cpp.o.d"
+  "/root/repo/test/trim-test.cpp" "CMakeFiles/tests.dir/test/trim-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/trim-test.cpp.o.d"
+  "/root/repo/test/usdt-test.cpp" "CMakeFiles/tests.dir/test/usdt-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/usdt-test.cpp.o.d"
+  "/root/repo/test/vector-test.cpp" "CMakeFiles/tests.dir/test/vector-test.cpp.o" "gcc" "CMakeFiles/tests.dir/test/vector-test.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
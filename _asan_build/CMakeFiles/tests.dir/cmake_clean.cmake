@@ -0,0 +1,43 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tests.dir/test/algorithm-test.cpp.o"
+  "CMakeFiles/tests.dir/test/algorithm-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/async-unshare-test.cpp.o"
+  "CMakeFiles/tests.dir/test/async-unshare-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/cow-test.cpp.o"
+  "CMakeFiles/tests.dir/test/cow-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/edit-plan-test.cpp.o"
+  "CMakeFiles/tests.dir/test/edit-plan-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/external-buffer-test.cpp.o"
+  "CMakeFiles/tests.dir/test/external-buffer-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/fused-algorithm-test.cpp.o"
+  "CMakeFiles/tests.dir/test/fused-algorithm-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/incremental-growth-test.cpp.o"
+  "CMakeFiles/tests.dir/test/incremental-growth-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/no-copy-scope-test.cpp.o"
+  "CMakeFiles/tests.dir/test/no-copy-scope-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/paged-cow-test.cpp.o"
+  "CMakeFiles/tests.dir/test/paged-cow-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/parallel-copy-test.cpp.o"
+  "CMakeFiles/tests.dir/test/parallel-copy-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/performance-test.cpp.o"
+  "CMakeFiles/tests.dir/test/performance-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/serialization-test.cpp.o"
+  "CMakeFiles/tests.dir/test/serialization-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/small-object-test.cpp.o"
+  "CMakeFiles/tests.dir/test/small-object-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/streaming-copy-test.cpp.o"
+  "CMakeFiles/tests.dir/test/streaming-copy-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/trim-test.cpp.o"
+  "CMakeFiles/tests.dir/test/trim-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/usdt-test.cpp.o"
+  "CMakeFiles/tests.dir/test/usdt-test.cpp.o.d"
+  "CMakeFiles/tests.dir/test/vector-test.cpp.o"
+  "CMakeFiles/tests.dir/test/vector-test.cpp.o.d"
+  "tests"
+  "tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,16 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_asan_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test([=[tests]=] "/root/repo/_asan_build/tests")
+set_tests_properties([=[tests]=] PROPERTIES  LABELS "correctness" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;94;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[buffer-registry-test]=] "/root/repo/_asan_build/buffer-registry-test")
+set_tests_properties([=[buffer-registry-test]=] PROPERTIES  LABELS "correctness" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;94;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[call-site-test]=] "/root/repo/_asan_build/call-site-test")
+set_tests_properties([=[call-site-test]=] PROPERTIES  LABELS "correctness" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;94;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[cost-model-test]=] "/root/repo/_asan_build/cost-model-test")
+set_tests_properties([=[cost-model-test]=] PROPERTIES  LABELS "correctness" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;94;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[stats-test]=] "/root/repo/_asan_build/stats-test")
+set_tests_properties([=[stats-test]=] PROPERTIES  LABELS "correctness" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;94;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,183 @@
+#include "socow-algorithm.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+using std::as_const;
+
+// The socow-algorithm.h functions at every instruction set against the std:: algorithms over the same buffer.
+// The second argument is the socow_simd_level, or -1 for the std:: algorithm.
+
+namespace {
+
+template <typename T>
+using vector = socow_vector<T, 4>;
+
+// Values in [0, 100), so that searching for -1 scans everything.
+template <typename T>
+vector<T> make_values(size_t n, uint32_t seed) {
+  vector<T> v;
+  uint32_t x = seed;
+  for (size_t i = 0; i < n; ++i) {
+    x = x * 1664525 + 1013904223;
+    v.push_back(static_cast<T>((x >> 8) % 100));
+  }
+  return v;
+}
+
+template <typename T>
+const T* begin_of(const vector<T>& v) {
+  return as_const(v).data();
+}
+
+template <typename T>
+const T* end_of(const vector<T>& v) {
+  return as_const(v).data() + v.size();
+}
+
+struct find_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>&) {
+    return std::find(begin_of(a), end_of(a), T(-1));
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>&) {
+    return socow_find(a, T(-1));
+  }
+};
+
+struct count_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>&) {
+    return std::count(begin_of(a), end_of(a), T(7));
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>&) {
+    return socow_count(a, T(7));
+  }
+};
+
+struct min_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>&) {
+    return *std::min_element(begin_of(a), end_of(a));
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>&) {
+    return socow_min(a);
+  }
+};
+
+struct max_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>&) {
+    return *std::max_element(begin_of(a), end_of(a));
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>&) {
+    return socow_max(a);
+  }
+};
+
+struct sum_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>&) {
+    return std::accumulate(begin_of(a), end_of(a), T());
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>&) {
+    return socow_sum(a);
+  }
+};
+
+struct dot_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>& b) {
+    return std::inner_product(begin_of(a), end_of(a), begin_of(b), T());
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>& b) {
+    return socow_dot(a, b);
+  }
+};
+
+struct clamp_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>&) {
+    auto result = vector<T>::for_overwrite(a.size());
+    std::transform(begin_of(a), end_of(a), result.data(), [](T x) { return std::clamp(x, T(10), T(90)); });
+    return result;
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>&) {
+    return socow_clamp(a, T(10), T(90));
+  }
+};
+
+struct add_case {
+  template <typename T>
+  static auto run_std(const vector<T>& a, const vector<T>& b) {
+    auto result = vector<T>::for_overwrite(a.size());
+    std::transform(begin_of(a), end_of(a), begin_of(b), result.data(), std::plus<T>());
+    return result;
+  }
+
+  template <typename T>
+  static auto run_socow(const vector<T>& a, const vector<T>& b) {
+    return socow_add(a, b);
+  }
+};
+
+template <typename T, typename Case>
+void algorithm(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const vector<T> a = make_values<T>(n, 1);
+  const vector<T> b = make_values<T>(n, 2);
+  if (state.range(1) < 0) {
+    state.SetLabel("std");
+    for (auto _ : state) {
+      auto result = Case::run_std(a, b);
+      benchmark::DoNotOptimize(result);
+    }
+  } else {
+    constexpr const char* NAMES[] = {"scalar", "sse2", "avx2", "avx512"};
+    auto level = static_cast<socow_simd_level>(state.range(1));
+    state.SetLabel(NAMES[state.range(1)]);
+    socow_simd_config::max_level = level;
+    for (auto _ : state) {
+      auto result = Case::run_socow(a, b);
+      benchmark::DoNotOptimize(result);
+    }
+    socow_simd_config::max_level = socow_simd_level::avx512;
+  }
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(n * sizeof(T)));
+}
+
+} // namespace
+
+#define SOCOW_ALGORITHM_ARGS ->ArgsProduct({{4096, 1 << 20}, {-1, 0, 1, 2, 3}})
+
+#define SOCOW_ALGORITHM_ONE(type)                                                                                      \
+  BENCHMARK_TEMPLATE(algorithm, type, find_case) SOCOW_ALGORITHM_ARGS;                                                 \
+  BENCHMARK_TEMPLATE(algorithm, type, count_case) SOCOW_ALGORITHM_ARGS;                                                \
+  BENCHMARK_TEMPLATE(algorithm, type, min_case) SOCOW_ALGORITHM_ARGS;                                                  \
+  BENCHMARK_TEMPLATE(algorithm, type, max_case) SOCOW_ALGORITHM_ARGS;                                                  \
+  BENCHMARK_TEMPLATE(algorithm, type, sum_case) SOCOW_ALGORITHM_ARGS;                                                  \
+  BENCHMARK_TEMPLATE(algorithm, type, dot_case) SOCOW_ALGORITHM_ARGS;                                                  \
+  BENCHMARK_TEMPLATE(algorithm, type, clamp_case) SOCOW_ALGORITHM_ARGS;                                                \
+  BENCHMARK_TEMPLATE(algorithm, type, add_case) SOCOW_ALGORITHM_ARGS
+
+SOCOW_ALGORITHM_ONE(int);
+SOCOW_ALGORITHM_ONE(float);
+SOCOW_ALGORITHM_ONE(double);
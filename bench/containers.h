@@ -0,0 +1,165 @@
+#pragma once
+
+#include "socow-vector.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if __has_include(<boost/container/small_vector.hpp>)
+#include <boost/container/small_vector.hpp>
+#define SOCOW_BENCH_HAS_BOOST 1
+#else
+#define SOCOW_BENCH_HAS_BOOST 0
+#endif
+
+// The classic copy-on-write baseline: a vector behind a shared_ptr, copied on the first non-const access.
+template <typename T>
+class shared_cow_vector {
+public:
+  using value_type = T;
+  using iterator = typename std::vector<T>::iterator;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  shared_cow_vector() : _data(std::make_shared<std::vector<T>>()) {}
+
+  T& operator[](size_t index) {
+    return unique()[index];
+  }
+
+  const T& operator[](size_t index) const {
+    return (*_data)[index];
+  }
+
+  T* data() {
+    return unique().data();
+  }
+
+  const T* data() const {
+    return _data->data();
+  }
+
+  size_t size() const {
+    return _data->size();
+  }
+
+  size_t capacity() const {
+    return _data->capacity();
+  }
+
+  T& back() {
+    return unique().back();
+  }
+
+  iterator begin() {
+    return unique().begin();
+  }
+
+  iterator end() {
+    return unique().end();
+  }
+
+  const_iterator begin() const {
+    return _data->cbegin();
+  }
+
+  const_iterator end() const {
+    return _data->cend();
+  }
+
+  void push_back(const T& value) {
+    unique().push_back(value);
+  }
+
+  void pop_back() {
+    unique().pop_back();
+  }
+
+  iterator insert(const_iterator pos, const T& value) {
+    auto index = pos - _data->cbegin();
+    std::vector<T>& data = unique();
+    return data.insert(data.cbegin() + index, value);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    auto from = first - _data->cbegin(), to = last - _data->cbegin();
+    std::vector<T>& data = unique();
+    return data.erase(data.cbegin() + from, data.cbegin() + to);
+  }
+
+  void reserve(size_t capacity) {
+    unique().reserve(capacity);
+  }
+
+  void shrink_to_fit() {
+    unique().shrink_to_fit();
+  }
+
+  void swap(shared_cow_vector& other) noexcept {
+    _data.swap(other._data);
+  }
+
+private:
+  std::vector<T>& unique() {
+    if (_data.use_count() > 1) {
+      _data = std::make_shared<std::vector<T>>(*_data);
+    }
+    return *_data;
+  }
+
+  std::shared_ptr<std::vector<T>> _data;
+};
+
+// socow_vector with incremental growth enabled on construction.
+template <typename T, size_t SMALL_SIZE>
+class incremental_socow_vector : public socow_vector<T, SMALL_SIZE> {
+public:
+  incremental_socow_vector() {
+    this->set_incremental_growth(true);
+  }
+};
+
+template <typename T>
+T make_value(size_t i);
+
+template <>
+inline int make_value<int>(size_t i) {
+  return static_cast<int>(i);
+}
+
+// Long enough to defeat the small string optimization.
+template <>
+inline std::string make_value<std::string>(size_t i) {
+  return "socow-vector-benchmark-value-" + std::to_string(i);
+}
+
+template <typename Container>
+Container make_container(size_t n) {
+  Container c;
+  for (size_t i = 0; i < n; ++i) {
+    c.push_back(make_value<typename Container::value_type>(i));
+  }
+  return c;
+}
+
+using socow_int_4 = socow_vector<int, 4>;
+using socow_int_32 = socow_vector<int, 32>;
+using socow_string_4 = socow_vector<std::string, 4>;
+using socow_string_32 = socow_vector<std::string, 32>;
+using socow_int_4_incremental = incremental_socow_vector<int, 4>;
+using socow_string_4_incremental = incremental_socow_vector<std::string, 4>;
+
+using std_int = std::vector<int>;
+using std_string = std::vector<std::string>;
+
+using shared_cow_int = shared_cow_vector<int>;
+using shared_cow_string = shared_cow_vector<std::string>;
+
+#if SOCOW_BENCH_HAS_BOOST
+using boost_small_int_4 = boost::container::small_vector<int, 4>;
+using boost_small_int_32 = boost::container::small_vector<int, 32>;
+using boost_small_string_4 = boost::container::small_vector<std::string, 4>;
+using boost_small_string_32 = boost::container::small_vector<std::string, 32>;
+#endif
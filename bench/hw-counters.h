@@ -0,0 +1,152 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SOCOW_BENCH_HAS_PERF_EVENTS 1
+#else
+#define SOCOW_BENCH_HAS_PERF_EVENTS 0
+#endif
+
+// Hardware performance counters of the calling thread, read through perf_event_open. Counters that the CPU, the
+// kernel or the container do not allow are skipped, so the set may be partial or empty.
+class hw_counters {
+public:
+  static hw_counters& instance() {
+    static hw_counters counters;
+    return counters;
+  }
+
+  hw_counters(const hw_counters&) = delete;
+
+  ~hw_counters() {
+#if SOCOW_BENCH_HAS_PERF_EVENTS
+    for (const counter& c : counters) {
+      close(c.fd);
+    }
+#endif
+  }
+
+  // Returns false if no counter could be opened.
+  bool open(std::ostream& log) {
+#if SOCOW_BENCH_HAS_PERF_EVENTS
+    constexpr uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    const event events[] = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {"l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss},
+        {"llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss},
+        {"dtlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss},
+    };
+    for (const event& e : events) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = e.type;
+      attr.config = e.config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if (fd < 0) {
+        log << "hardware counter " << e.name << " is unavailable: " << std::strerror(errno) << "\n";
+        continue;
+      }
+      counters.push_back({e.name, fd});
+    }
+#else
+    log << "hardware counters are not supported on this platform\n";
+#endif
+    return !counters.empty();
+  }
+
+  bool enabled() const noexcept {
+    return !counters.empty();
+  }
+
+  // Counter values scaled for the time the kernel multiplexed them out, in the order of names().
+  std::vector<double> read() const {
+    std::vector<double> values;
+#if SOCOW_BENCH_HAS_PERF_EVENTS
+    for (const counter& c : counters) {
+      uint64_t data[3] = {};
+      if (::read(c.fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+        values.push_back(0);
+        continue;
+      }
+      values.push_back(static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]));
+    }
+#endif
+    return values;
+  }
+
+  std::vector<std::string> names() const {
+    std::vector<std::string> result;
+    for (const counter& c : counters) {
+      result.push_back(c.name);
+    }
+    return result;
+  }
+
+private:
+  struct event {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+  };
+
+  struct counter {
+    std::string name;
+    int fd;
+  };
+
+  hw_counters() = default;
+
+  std::vector<counter> counters;
+};
+
+// Reports the enabled hardware counters per iteration of the benchmark loop. Construct right before the loop so that
+// the setup is not counted.
+class hw_counters_scope {
+public:
+  explicit hw_counters_scope(benchmark::State& state) : state(state), start(hw_counters::instance().read()) {}
+
+  hw_counters_scope(const hw_counters_scope&) = delete;
+
+  ~hw_counters_scope() {
+    const hw_counters& counters = hw_counters::instance();
+    if (!counters.enabled()) {
+      return;
+    }
+    std::vector<double> end = counters.read();
+    std::vector<std::string> names = counters.names();
+    double cycles = 0, instructions = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+      double delta = end[i] - start[i];
+      state.counters[names[i]] = benchmark::Counter(delta, benchmark::Counter::kAvgIterations);
+      if (names[i] == "cycles") {
+        cycles = delta;
+      } else if (names[i] == "instructions") {
+        instructions = delta;
+      }
+    }
+    if (cycles > 0 && instructions > 0) {
+      state.counters["ipc"] = instructions / cycles;
+    }
+  }
+
+private:
+  benchmark::State& state;
+  std::vector<double> start;
+};
@@ -0,0 +1,100 @@
+#include "containers.h"
+#include "latency-histogram.h"
+
+#include <benchmark/benchmark.h>
+
+#include <utility>
+
+using std::as_const;
+
+// Per-operation latency distributions: every operation is timed on its own, so the reallocation in push_back or the
+// unshare on the first write after a copy show up in the tail instead of being averaged away.
+
+namespace {
+
+void report(benchmark::State& state, const latency_histogram& histogram) {
+  state.counters["p50_ns"] = static_cast<double>(histogram.percentile(50));
+  state.counters["p99_ns"] = static_cast<double>(histogram.percentile(99));
+  state.counters["p99.9_ns"] = static_cast<double>(histogram.percentile(99.9));
+  state.counters["max_ns"] = static_cast<double>(histogram.max());
+}
+
+// Grows a container up to the given size and starts over, so every reallocation is hit repeatedly.
+template <typename Container>
+void push_back_latency(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  auto value = make_value<typename Container::value_type>(n);
+  latency_histogram histogram;
+  Container c;
+  for (auto _ : state) {
+    histogram.time([&] { c.push_back(value); });
+    if (c.size() == n) {
+      c = Container();
+    }
+  }
+  report(state, histogram);
+}
+
+template <typename Container>
+void insert_middle_latency(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  auto value = make_value<typename Container::value_type>(n);
+  latency_histogram histogram;
+  Container c = make_container<Container>(n);
+  for (auto _ : state) {
+    histogram.time([&] { c.insert(as_const(c).begin() + n / 2, value); });
+    c.pop_back();
+  }
+  report(state, histogram);
+}
+
+template <typename Container>
+void erase_front_latency(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  auto value = make_value<typename Container::value_type>(n);
+  latency_histogram histogram;
+  Container c = make_container<Container>(n);
+  for (auto _ : state) {
+    histogram.time([&] { c.erase(as_const(c).begin(), as_const(c).begin() + 1); });
+    c.push_back(value);
+  }
+  report(state, histogram);
+}
+
+// Writes through operator[] and takes a snapshot copy every 1024 operations. Both the snapshots and the writes are
+// timed: std::vector pays at the copy, socow_vector at the first write after it.
+template <typename Container>
+void write_with_snapshots_latency(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  auto value = make_value<typename Container::value_type>(n);
+  latency_histogram histogram;
+  Container c = make_container<Container>(n);
+  Container snapshot;
+  size_t i = 0;
+  for (auto _ : state) {
+    if (++i % 1024 == 0) {
+      histogram.time([&] { snapshot = c; });
+    } else {
+      histogram.time([&] { c[i % n] = value; });
+    }
+  }
+  benchmark::DoNotOptimize(snapshot);
+  report(state, histogram);
+}
+
+} // namespace
+
+#define SOCOW_LATENCY_SIZES ->Arg(4096)->Arg(1 << 16)
+
+#define SOCOW_LATENCY_ONE(container)                                                                                   \
+  BENCHMARK_TEMPLATE(push_back_latency, container) SOCOW_LATENCY_SIZES;                                                \
+  BENCHMARK_TEMPLATE(insert_middle_latency, container) SOCOW_LATENCY_SIZES;                                            \
+  BENCHMARK_TEMPLATE(erase_front_latency, container) SOCOW_LATENCY_SIZES;                                              \
+  BENCHMARK_TEMPLATE(write_with_snapshots_latency, container) SOCOW_LATENCY_SIZES
+
+SOCOW_LATENCY_ONE(socow_int_4);
+SOCOW_LATENCY_ONE(socow_string_4);
+SOCOW_LATENCY_ONE(socow_int_4_incremental);
+SOCOW_LATENCY_ONE(socow_string_4_incremental);
+SOCOW_LATENCY_ONE(std_int);
+SOCOW_LATENCY_ONE(std_string);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// A log-linear histogram in the spirit of HdrHistogram: values below 64 are exact, larger ones fall into one of
+// 32 sub-buckets per power of two, so every reported value is within about 3% of the recorded one.
+class latency_histogram {
+public:
+  void record(uint64_t value) noexcept {
+    ++counts[index_of(value)];
+    ++total;
+    largest = value > largest ? value : largest;
+  }
+
+  // Records the duration of `op` in nanoseconds.
+  template <typename Op>
+  void time(Op&& op) {
+    auto start = std::chrono::steady_clock::now();
+    op();
+    auto finish = std::chrono::steady_clock::now();
+    record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count()));
+  }
+
+  // The smallest bucket bound that at least `percent` of the recorded values do not exceed.
+  uint64_t percentile(double percent) const noexcept {
+    if (total == 0) {
+      return 0;
+    }
+    auto rank = static_cast<uint64_t>(percent / 100 * static_cast<double>(total));
+    rank = rank == 0 ? 1 : rank;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint64_t bound = upper_bound_of(i);
+        return bound < largest ? bound : largest;
+      }
+    }
+    return largest;
+  }
+
+  uint64_t max() const noexcept {
+    return largest;
+  }
+
+  uint64_t count() const noexcept {
+    return total;
+  }
+
+private:
+  static constexpr unsigned HALF_BITS = 5;
+  static constexpr uint64_t HALF = uint64_t(1) << HALF_BITS;
+  static constexpr size_t BUCKETS = (64 - HALF_BITS + 1) * HALF;
+
+  static size_t index_of(uint64_t value) noexcept {
+    if (value < 2 * HALF) {
+      return value;
+    }
+    unsigned shift = static_cast<unsigned>(std::bit_width(value)) - HALF_BITS - 1;
+    return shift * HALF + (value >> shift);
+  }
+
+  static uint64_t upper_bound_of(size_t index) noexcept {
+    if (index < 2 * HALF) {
+      return index;
+    }
+    unsigned shift = static_cast<unsigned>(index / HALF - 1);
+    uint64_t sub = index % HALF + HALF;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  std::array<uint64_t, BUCKETS> counts{};
+  uint64_t total = 0;
+  uint64_t largest = 0;
+};
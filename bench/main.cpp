@@ -0,0 +1,63 @@
+#include "hw-counters.h"
+#include "perf-check.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char* take_flag(int& argc, char** argv, const char* name) {
+  size_t length = std::strlen(name);
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=') {
+      const char* value = argv[i] + length + 1;
+      for (int j = i; j + 1 < argc; ++j) {
+        argv[j] = argv[j + 1];
+      }
+      --argc;
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+// In addition to the Google Benchmark flags:
+//   --perf_baseline=<file>   compare median CPU times with the baseline and fail on regressions
+//   --perf_threshold=<pct>   allowed slowdown in percent, 25 by default
+//   --perf_reference=<name>  benchmark whose change against the baseline is divided out of the other results
+//   --perf_update=<file>     write the measured medians as a new baseline
+//   --hw_counters=1          report hardware counters per iteration where the system allows perf_event_open
+int main(int argc, char** argv) {
+  const char* baseline_path = take_flag(argc, argv, "--perf_baseline");
+  const char* threshold = take_flag(argc, argv, "--perf_threshold");
+  const char* reference = take_flag(argc, argv, "--perf_reference");
+  const char* update_path = take_flag(argc, argv, "--perf_update");
+  const char* counters = take_flag(argc, argv, "--hw_counters");
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  if (counters && std::strcmp(counters, "0") != 0 && !hw_counters::instance().open(std::cerr)) {
+    std::cerr << "running without hardware counters\n";
+  }
+
+  perf_check_reporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+  benchmark::Shutdown();
+
+  if (update_path) {
+    save_perf_baseline(update_path, reporter.results());
+  }
+  if (baseline_path) {
+    bool ok = compare_with_perf_baseline(load_perf_baseline(baseline_path), reporter.results(),
+                                         threshold ? std::stod(threshold) : 25, reference ? reference : "");
+    return ok ? 0 : 1;
+  }
+  return 0;
+}
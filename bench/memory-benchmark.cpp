@@ -0,0 +1,110 @@
+#include "alloc-tracker.h"
+#include "containers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// Memory footprint and allocation counts, measured through the replacement operator new/delete. The timings of
+// these cases include the tracking overhead and are not meant to be compared with the benchmarks target.
+
+namespace {
+
+// Heap owned by the values themselves (long strings), to be subtracted from the container's heap.
+template <typename T>
+size_t value_heap_bytes(size_t n) {
+  std::vector<T> values;
+  values.reserve(n);
+  alloc_scope scope;
+  for (size_t i = 0; i < n; ++i) {
+    values.push_back(make_value<T>(i));
+  }
+  return static_cast<size_t>(scope.live_bytes());
+}
+
+struct footprint {
+  size_t heap_bytes = 0;
+  size_t peak_bytes = 0;
+  size_t allocations = 0;
+};
+
+template <typename Container>
+footprint built_footprint(size_t n) {
+  using T = typename Container::value_type;
+  size_t values = value_heap_bytes<T>(n);
+  alloc_scope scope;
+  Container c = make_container<Container>(n);
+  benchmark::DoNotOptimize(c);
+  return {static_cast<size_t>(scope.live_bytes()) - values, scope.peak_bytes() - values, scope.delta().allocations};
+}
+
+double bytes_per_element(size_t object_size, size_t heap_bytes, size_t n) {
+  return static_cast<double>(object_size + heap_bytes) / static_cast<double>(n);
+}
+
+// Bytes requested from the heap and the object itself, per element, against std::vector with the same values.
+template <typename Container>
+void footprint_after_push_back(benchmark::State& state) {
+  using T = typename Container::value_type;
+  auto n = static_cast<size_t>(state.range(0));
+  footprint result;
+  for (auto _ : state) {
+    result = built_footprint<Container>(n);
+  }
+  footprint reference = built_footprint<std::vector<T>>(n);
+  double per_element = bytes_per_element(sizeof(Container), result.heap_bytes, n);
+
+  state.counters["allocs"] = static_cast<double>(result.allocations);
+  state.counters["heap_bytes"] = static_cast<double>(result.heap_bytes);
+  state.counters["used_bytes"] = static_cast<double>(n * sizeof(T));
+  state.counters["peak_bytes"] = static_cast<double>(result.peak_bytes);
+  state.counters["bytes_per_elem"] = per_element;
+  state.counters["overhead_per_elem"] = per_element - static_cast<double>(sizeof(T));
+  state.counters["vs_std_per_elem"] =
+      per_element - bytes_per_element(sizeof(std::vector<T>), reference.heap_bytes, n);
+}
+
+// Allocations and peak heap of copying a container and writing to the copy.
+template <typename Container>
+void copy_then_write_allocs(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  auto value = make_value<typename Container::value_type>(n);
+  alloc_stats copy_stats, write_stats;
+  for (auto _ : state) {
+    alloc_scope copy_scope;
+    Container c = source;
+    copy_stats = copy_scope.delta();
+    alloc_scope write_scope;
+    c[0] = value;
+    write_stats = write_scope.delta();
+    benchmark::DoNotOptimize(c);
+  }
+  state.counters["copy_allocs"] = static_cast<double>(copy_stats.allocations);
+  state.counters["copy_bytes"] = static_cast<double>(copy_stats.bytes_allocated);
+  state.counters["write_allocs"] = static_cast<double>(write_stats.allocations);
+  state.counters["write_bytes"] = static_cast<double>(write_stats.bytes_allocated);
+}
+
+} // namespace
+
+#define SOCOW_MEMORY_SIZES ->Arg(1)->Arg(4)->Arg(16)->Arg(32)->Arg(256)->Arg(4096)->Arg(1 << 16)->Iterations(3)
+
+#define SOCOW_MEMORY_ONE(container)                                                                                    \
+  BENCHMARK_TEMPLATE(footprint_after_push_back, container) SOCOW_MEMORY_SIZES;                                         \
+  BENCHMARK_TEMPLATE(copy_then_write_allocs, container) SOCOW_MEMORY_SIZES
+
+SOCOW_MEMORY_ONE(socow_int_4);
+SOCOW_MEMORY_ONE(socow_int_32);
+SOCOW_MEMORY_ONE(socow_string_4);
+SOCOW_MEMORY_ONE(socow_string_32);
+SOCOW_MEMORY_ONE(std_int);
+SOCOW_MEMORY_ONE(std_string);
+SOCOW_MEMORY_ONE(shared_cow_int);
+SOCOW_MEMORY_ONE(shared_cow_string);
+#if SOCOW_BENCH_HAS_BOOST
+SOCOW_MEMORY_ONE(boost_small_int_4);
+SOCOW_MEMORY_ONE(boost_small_int_32);
+SOCOW_MEMORY_ONE(boost_small_string_4);
+SOCOW_MEMORY_ONE(boost_small_string_32);
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Collects the median CPU time of every benchmark (or its only run without repetitions) and compares it with a
+// baseline stored as a flat JSON object {"<benchmark name>": <nanoseconds>, ...}.
+class perf_check_reporter : public benchmark::ConsoleReporter {
+public:
+  void ReportRuns(const std::vector<Run>& reports) override {
+    for (const Run& run : reports) {
+      double nanoseconds = run.GetAdjustedCPUTime() / benchmark::GetTimeUnitMultiplier(run.time_unit) * 1e9;
+      if (run.run_type == Run::RT_Aggregate && run.aggregate_name == "median") {
+        medians[run.run_name.str()] = nanoseconds;
+      } else if (run.run_type == Run::RT_Iteration && !run.error_occurred) {
+        singles.emplace(run.run_name.str(), nanoseconds);
+      }
+    }
+    ConsoleReporter::ReportRuns(reports);
+  }
+
+  std::map<std::string, double> results() const {
+    std::map<std::string, double> result = singles;
+    for (const auto& [name, nanoseconds] : medians) {
+      result[name] = nanoseconds;
+    }
+    return result;
+  }
+
+private:
+  std::map<std::string, double> medians;
+  std::map<std::string, double> singles;
+};
+
+inline std::map<std::string, double> load_perf_baseline(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open perf baseline " + path);
+  }
+  std::stringstream content;
+  content << in.rdbuf();
+  std::string text = content.str();
+
+  static const std::regex entry(R"re("((?:[^"\\]|\\.)*)"\s*:\s*([-+0-9.eE]+))re");
+  std::map<std::string, double> baseline;
+  for (auto it = std::sregex_iterator(text.begin(), text.end(), entry); it != std::sregex_iterator(); ++it) {
+    baseline[(*it)[1].str()] = std::stod((*it)[2].str());
+  }
+  return baseline;
+}
+
+inline void save_perf_baseline(const std::string& path, const std::map<std::string, double>& results) {
+  std::ofstream out(path);
+  out << "{\n";
+  size_t i = 0;
+  for (const auto& [name, nanoseconds] : results) {
+    out << "  \"" << name << "\": " << std::setprecision(6) << nanoseconds << (++i < results.size() ? ",\n" : "\n");
+  }
+  out << "}\n";
+}
+
+// Returns false if some benchmark got slower than the baseline by more than `threshold_percent`, or didn't run at
+// all, so that a renamed benchmark or a filter that matches nothing can't pass. With a `reference` benchmark, the
+// results are first scaled by how much faster or slower it ran than in the baseline, which cancels out most of
+// the difference between the host that recorded the baseline and this one.
+inline bool compare_with_perf_baseline(const std::map<std::string, double>& baseline,
+                                       const std::map<std::string, double>& results, double threshold_percent,
+                                       const std::string& reference = {}) {
+  bool ok = true;
+  double scale = 1;
+  std::cout << "\nperf check, threshold " << threshold_percent << "%\n";
+  if (!reference.empty()) {
+    auto then = baseline.find(reference);
+    auto now = results.find(reference);
+    if (then == baseline.end() || now == results.end()) {
+      std::cout << "  MISSING  reference " << reference << "\n";
+      return false;
+    }
+    scale = now->second / then->second;
+    std::cout << "  reference " << reference << ": " << then->second << " ns -> " << now->second
+              << " ns, results divided by " << scale << "\n";
+  }
+  for (const auto& [name, measured] : results) {
+    if (name == reference) {
+      continue;
+    }
+    double nanoseconds = measured / scale;
+    auto it = baseline.find(name);
+    if (it == baseline.end()) {
+      std::cout << "  NEW      " << name << ": " << nanoseconds << " ns (not in baseline)\n";
+      continue;
+    }
+    double change = (nanoseconds / it->second - 1) * 100;
+    bool regressed = change > threshold_percent;
+    ok &= !regressed;
+    std::cout << (regressed ? "  REGRESS  " : "  ok       ") << name << ": " << it->second << " ns -> " << nanoseconds
+              << " ns (" << std::showpos << std::fixed << std::setprecision(1) << change << "%)" << std::noshowpos
+              << std::defaultfloat << std::setprecision(6) << "\n";
+  }
+  for (const auto& [name, nanoseconds] : baseline) {
+    if (results.find(name) == results.end()) {
+      std::cout << "  MISSING  " << name << " (in baseline only)\n";
+      ok = false;
+    }
+  }
+  return ok;
+}
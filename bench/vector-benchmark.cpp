@@ -0,0 +1,340 @@
+#include "containers.h"
+#include "hw-counters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::as_const;
+
+namespace {
+
+template <typename Container>
+void push_back(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    Container c;
+    for (size_t i = 0; i < n; ++i) {
+      c.push_back(make_value<typename Container::value_type>(i));
+    }
+    benchmark::DoNotOptimize(c);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+// Inserts at `numerator / denominator` of the size and pops the last element to keep the size constant.
+template <typename Container, size_t numerator, size_t denominator>
+void insert(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  Container c = make_container<Container>(n);
+  auto value = make_value<typename Container::value_type>(n);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    c.insert(as_const(c).begin() + n * numerator / denominator, value);
+    c.pop_back();
+    benchmark::ClobberMemory();
+  }
+}
+
+template <typename Container>
+void insert_front(benchmark::State& state) {
+  insert<Container, 0, 1>(state);
+}
+
+template <typename Container>
+void insert_middle(benchmark::State& state) {
+  insert<Container, 1, 2>(state);
+}
+
+template <typename Container>
+void insert_back(benchmark::State& state) {
+  insert<Container, 1, 1>(state);
+}
+
+// Erasing from a fresh copy measures the fused filtered copy of socow_vector against copy-then-erase.
+template <typename Container>
+void copy_erase_range(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    Container c = source;
+    c.erase(as_const(c).begin() + n / 4, as_const(c).end() - n / 4);
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+template <typename Container>
+void copy(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    Container c = source;
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+template <typename Container>
+void copy_then_write(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  auto value = make_value<typename Container::value_type>(n);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    Container c = source;
+    c[0] = value;
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+template <typename Container>
+void swap(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  Container a = make_container<Container>(n);
+  Container b = make_container<Container>(n / 2);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    a.swap(b);
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+  }
+}
+
+template <typename Container>
+void reserve_shrink_to_fit(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  Container c = make_container<Container>(n);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    c.reserve(2 * n);
+    c.shrink_to_fit();
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+template <typename Outer>
+void nested_push_back(benchmark::State& state) {
+  using Inner = typename Outer::value_type;
+  auto n = static_cast<size_t>(state.range(0));
+  const Inner row = make_container<Inner>(16);
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    Outer c;
+    for (size_t i = 0; i < n; ++i) {
+      c.push_back(row);
+    }
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+template <typename Outer>
+void nested_copy_then_write(benchmark::State& state) {
+  using Inner = typename Outer::value_type;
+  auto n = static_cast<size_t>(state.range(0));
+  Outer source;
+  for (size_t i = 0; i < n; ++i) {
+    source.push_back(make_container<Inner>(16));
+  }
+  hw_counters_scope counters(state);
+  for (auto _ : state) {
+    Outer c = source;
+    c[n / 2][0] = 42;
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+// Unshares a big buffer with the copy split between state.range(1) threads.
+template <typename Container>
+void parallel_unshare(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  auto value = make_value<typename Container::value_type>(n);
+  socow_config::parallel_copy_threshold = 1;
+  socow_config::parallel_copy_threads = static_cast<size_t>(state.range(1));
+  for (auto _ : state) {
+    Container c = source;
+    c[0] = value;
+    benchmark::DoNotOptimize(c);
+  }
+  socow_config::parallel_copy_threshold = 0;
+  socow_config::parallel_copy_threads = 0;
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(n * sizeof(typename Container::value_type)));
+}
+
+// Unshares a big buffer of trivially copyable elements with normal or, if state.range(1) is set, non-temporal stores.
+template <typename Container>
+void streaming_unshare(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  auto value = make_value<typename Container::value_type>(n);
+  socow_config::streaming_copy_threshold = state.range(1) ? 1 : 0;
+  for (auto _ : state) {
+    Container c = source;
+    c[0] = value;
+    benchmark::DoNotOptimize(c);
+  }
+  socow_config::streaming_copy_threshold = 0;
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(n * sizeof(typename Container::value_type)));
+}
+
+// The damage an unshare does to other work: another thread keeps passing over a 1 MiB working set while a buffer
+// of state.range(0) ints is unshared with normal or non-temporal stores, and only the mean time of those passes is
+// reported. With a single core the passes still interleave with the copy through time slicing.
+void hot_set_after_unshare(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  const socow_int_4 source = make_container<socow_int_4>(n);
+  std::vector<int> hot(1 << 18, 1);
+  socow_config::streaming_copy_threshold = state.range(1) ? 1 : 0;
+  for (auto _ : state) {
+    socow_int_4 c = source;
+    std::atomic<bool> copying = true;
+    std::chrono::duration<double> elapsed{};
+    size_t passes = 0;
+    std::thread reader([&] {
+      do {
+        auto start = std::chrono::steady_clock::now();
+        int sum = 0;
+        for (int x : hot) {
+          sum += x;
+        }
+        benchmark::DoNotOptimize(sum);
+        elapsed += std::chrono::steady_clock::now() - start;
+        ++passes;
+      } while (copying.load(std::memory_order_relaxed));
+    });
+    c[0] = 0;
+    copying = false;
+    reader.join();
+    benchmark::DoNotOptimize(c);
+    state.SetIterationTime(elapsed.count() / static_cast<double>(passes));
+  }
+  socow_config::streaming_copy_threshold = 0;
+}
+
+// Modifies every element of a fresh copy: with state.range(1) through the fused transform_inplace, otherwise by
+// unsharing through data() and then assigning.
+template <typename Container>
+void copy_then_transform(benchmark::State& state) {
+  using value_type = typename Container::value_type;
+  auto n = static_cast<size_t>(state.range(0));
+  const Container source = make_container<Container>(n);
+  auto value = make_value<value_type>(n);
+  for (auto _ : state) {
+    Container c = source;
+    if (state.range(1)) {
+      c.transform_inplace([&value](const value_type&) { return value; });
+    } else {
+      for (value_type *p = c.data(), *last = p + c.size(); p != last; ++p) {
+        *p = value;
+      }
+    }
+    benchmark::DoNotOptimize(c);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+// Applies state.range(1) inserts and as many erases, spread evenly over a fresh copy of state.range(0) ints: with
+// state.range(2) through one edit_plan, otherwise one call at a time from the back.
+void scattered_edits(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  auto k = static_cast<size_t>(state.range(1));
+  const socow_int_4 source = make_container<socow_int_4>(n);
+  for (auto _ : state) {
+    socow_int_4 c = source;
+    if (state.range(2)) {
+      socow_int_4::edit_plan plan;
+      for (size_t i = 0; i < k; ++i) {
+        plan.insert(n * i / k, static_cast<int>(i));
+        plan.erase(n * i / k + 1);
+      }
+      c.apply(std::move(plan));
+    } else {
+      for (size_t i = k; i-- > 0;) {
+        c.erase(as_const(c).begin() + n * i / k + 1);
+        c.insert(as_const(c).begin() + n * i / k, static_cast<int>(i));
+      }
+    }
+    benchmark::DoNotOptimize(c);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 2 * k));
+}
+
+// Doesn't use socow_vector: the perf check divides the other results by its change against the baseline.
+void perf_reference(benchmark::State& state) {
+  std::vector<int> source(4096, 1);
+  for (auto _ : state) {
+    std::vector<int> copy = source;
+    int sum = 0;
+    for (int& x : copy) {
+      x += sum;
+      sum ^= x;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+} // namespace
+
+#define SOCOW_BENCH_SIZES ->RangeMultiplier(16)->Range(16, 1 << 16)
+
+#define SOCOW_BENCH_ONE(container)                                                                                     \
+  BENCHMARK_TEMPLATE(push_back, container) SOCOW_BENCH_SIZES;                                                          \
+  BENCHMARK_TEMPLATE(insert_front, container) SOCOW_BENCH_SIZES;                                                       \
+  BENCHMARK_TEMPLATE(insert_middle, container) SOCOW_BENCH_SIZES;                                                      \
+  BENCHMARK_TEMPLATE(insert_back, container) SOCOW_BENCH_SIZES;                                                        \
+  BENCHMARK_TEMPLATE(copy_erase_range, container) SOCOW_BENCH_SIZES;                                                   \
+  BENCHMARK_TEMPLATE(copy, container) SOCOW_BENCH_SIZES;                                                               \
+  BENCHMARK_TEMPLATE(copy_then_write, container) SOCOW_BENCH_SIZES;                                                    \
+  BENCHMARK_TEMPLATE(swap, container) SOCOW_BENCH_SIZES;                                                               \
+  BENCHMARK_TEMPLATE(reserve_shrink_to_fit, container) SOCOW_BENCH_SIZES
+
+SOCOW_BENCH_ONE(socow_int_4);
+SOCOW_BENCH_ONE(socow_int_32);
+SOCOW_BENCH_ONE(socow_string_4);
+SOCOW_BENCH_ONE(socow_string_32);
+SOCOW_BENCH_ONE(std_int);
+SOCOW_BENCH_ONE(std_string);
+SOCOW_BENCH_ONE(shared_cow_int);
+SOCOW_BENCH_ONE(shared_cow_string);
+#if SOCOW_BENCH_HAS_BOOST
+SOCOW_BENCH_ONE(boost_small_int_4);
+SOCOW_BENCH_ONE(boost_small_int_32);
+SOCOW_BENCH_ONE(boost_small_string_4);
+SOCOW_BENCH_ONE(boost_small_string_32);
+#endif
+
+#define SOCOW_BENCH_NESTED(outer, inner)                                                                               \
+  BENCHMARK_TEMPLATE(nested_push_back, outer<inner>)->RangeMultiplier(16)->Range(16, 1 << 12);                         \
+  BENCHMARK_TEMPLATE(nested_copy_then_write, outer<inner>)->RangeMultiplier(16)->Range(16, 1 << 12)
+
+template <typename T>
+using socow_outer_4 = socow_vector<T, 4>;
+template <typename T>
+using std_outer = std::vector<T>;
+template <typename T>
+using shared_cow_outer = shared_cow_vector<T>;
+
+SOCOW_BENCH_NESTED(socow_outer_4, socow_int_4);
+SOCOW_BENCH_NESTED(std_outer, std_int);
+SOCOW_BENCH_NESTED(shared_cow_outer, shared_cow_int);
+#if SOCOW_BENCH_HAS_BOOST
+template <typename T>
+using boost_small_outer_4 = boost::container::small_vector<T, 4>;
+
+SOCOW_BENCH_NESTED(boost_small_outer_4, boost_small_int_4);
+#endif
+
+BENCHMARK_TEMPLATE(parallel_unshare, socow_int_4)->ArgsProduct({{1 << 20, 1 << 24}, {1, 2, 4, 8}})->UseRealTime();
+BENCHMARK_TEMPLATE(parallel_unshare, socow_string_4)->ArgsProduct({{1 << 16, 1 << 20}, {1, 2, 4, 8}})->UseRealTime();
+BENCHMARK_TEMPLATE(streaming_unshare, socow_int_4)->ArgsProduct({{1 << 16, 1 << 20, 1 << 24}, {0, 1}})->UseRealTime();
+BENCHMARK(perf_reference);
+BENCHMARK(hot_set_after_unshare)->ArgsProduct({{1 << 24}, {0, 1}})->UseManualTime();
+BENCHMARK_TEMPLATE(copy_then_transform, socow_int_4)->ArgsProduct({{1 << 12, 1 << 20}, {0, 1}});
+BENCHMARK_TEMPLATE(copy_then_transform, socow_string_4)->ArgsProduct({{1 << 12, 1 << 16}, {0, 1}});
+BENCHMARK(scattered_edits)->ArgsProduct({{1 << 16}, {16, 1024}, {0, 1}});
@@ -4,4 +4,6 @@ IFS=$' \t\n'
 
 SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
 
-valgrind --tool=memcheck --gen-suppressions=all --leak-check=full --show-leak-kinds=all --leak-resolution=med --track-origins=yes --vgdb=no --error-exitcode=1 --suppressions="${SCRIPT_DIR}/valgrind.suppressions" cmake-build-RelWithDebInfo/tests
+for test in tests buffer-registry-test call-site-test cost-model-test stats-test; do
+  valgrind --tool=memcheck --gen-suppressions=all --leak-check=full --show-leak-kinds=all --leak-resolution=med --track-origins=yes --vgdb=no --error-exitcode=1 --suppressions="${SCRIPT_DIR}/valgrind.suppressions" cmake-build-RelWithDebInfo/$test
+done
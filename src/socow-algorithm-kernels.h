@@ -0,0 +1,164 @@
+// The kernels of socow-algorithm.h. No include guard: socow-algorithm.h includes this file once per instruction
+// set, inside a namespace that defines BYTES (the vector width) and inside a region compiled for that instruction
+// set, so every instantiation of these templates gets its instructions. Only call it from there.
+
+template <typename T>
+struct simd {
+  typedef T vec __attribute__((vector_size(BYTES)));
+  using mask = decltype(vec{} == vec{});
+  static constexpr size_t LANES = BYTES / sizeof(T);
+};
+
+#define SOCOW_SIMD_LOAD(v, p) std::memcpy(&(v), (p), sizeof(v))
+
+inline bool any_set(const void* m) noexcept {
+  uint64_t words[BYTES / 8];
+  std::memcpy(words, m, BYTES);
+  uint64_t any = 0;
+  for (uint64_t word : words) {
+    any |= word;
+  }
+  return any != 0;
+}
+
+template <typename Op>
+struct kernel;
+
+template <>
+struct kernel<find_op> {
+  template <typename T>
+  static size_t run(const T* p, size_t n, T value) noexcept {
+    using s = simd<T>;
+    typename s::vec a, b, c, d;
+    size_t i = 0;
+    for (; i + 4 * s::LANES <= n; i += 4 * s::LANES) {
+      SOCOW_SIMD_LOAD(a, p + i);
+      SOCOW_SIMD_LOAD(b, p + i + s::LANES);
+      SOCOW_SIMD_LOAD(c, p + i + 2 * s::LANES);
+      SOCOW_SIMD_LOAD(d, p + i + 3 * s::LANES);
+      typename s::mask m = (a == value) | (b == value) | (c == value) | (d == value);
+      if (any_set(&m)) {
+        break;
+      }
+    }
+    return i + find_op::scalar(p + i, n - i, value);
+  }
+};
+
+template <>
+struct kernel<count_op> {
+  template <typename T>
+  static size_t run(const T* p, size_t n, T value) noexcept {
+    using s = simd<T>;
+    using lane = std::remove_cvref_t<decltype(typename s::mask{}[0])>;
+    // Lanes count down from 0 and are flushed before they can overflow.
+    constexpr size_t FLUSH = sizeof(lane) >= 8 ? SIZE_MAX : (size_t(1) << (8 * sizeof(lane) - 1)) - 1;
+    size_t result = 0, i = 0;
+    while (i + s::LANES <= n) {
+      typename s::mask counts{};
+      for (size_t steps = 0; steps < FLUSH && i + s::LANES <= n; ++steps, i += s::LANES) {
+        typename s::vec v;
+        SOCOW_SIMD_LOAD(v, p + i);
+        counts += v == value;
+      }
+      for (size_t k = 0; k < s::LANES; ++k) {
+        result += static_cast<size_t>(-static_cast<int64_t>(counts[k]));
+      }
+    }
+    return result + count_op::scalar(p + i, n - i, value);
+  }
+};
+
+template <bool MIN>
+struct kernel<extremum_op<MIN>> {
+  template <typename T>
+  static T run(const T* p, size_t n) noexcept {
+    using s = simd<T>;
+    if (n < 4 * s::LANES) {
+      return extremum_op<MIN>::scalar(p, n);
+    }
+    typename s::vec acc[4], v;
+    for (size_t j = 0; j < 4; ++j) {
+      SOCOW_SIMD_LOAD(acc[j], p + j * s::LANES);
+    }
+    size_t i = 4 * s::LANES;
+    for (; i + 4 * s::LANES <= n; i += 4 * s::LANES) {
+      for (size_t j = 0; j < 4; ++j) {
+        SOCOW_SIMD_LOAD(v, p + i + j * s::LANES);
+        acc[j] = MIN ? (v < acc[j] ? v : acc[j]) : (acc[j] < v ? v : acc[j]);
+      }
+    }
+    T result = acc[0][0];
+    for (size_t j = 0; j < 4; ++j) {
+      for (size_t k = 0; k < s::LANES; ++k) {
+        result = MIN ? std::min(result, T(acc[j][k])) : std::max(result, T(acc[j][k]));
+      }
+    }
+    for (; i < n; ++i) {
+      result = MIN ? std::min(result, p[i]) : std::max(result, p[i]);
+    }
+    return result;
+  }
+};
+
+template <>
+struct kernel<dot_op> {
+  template <typename T>
+  static T run(const T* a, const T* b, size_t n) noexcept {
+    using s = simd<wrapping<T>>;
+    typename s::vec acc[4] = {}, x, y;
+    size_t i = 0;
+    for (; i + 4 * s::LANES <= n; i += 4 * s::LANES) {
+      for (size_t j = 0; j < 4; ++j) {
+        SOCOW_SIMD_LOAD(x, a + i + j * s::LANES);
+        if (b) {
+          SOCOW_SIMD_LOAD(y, b + i + j * s::LANES);
+          x *= y;
+        }
+        acc[j] += x;
+      }
+    }
+    typename s::vec total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    auto result = static_cast<wrapping<T>>(dot_op::scalar(a + i, b ? b + i : nullptr, n - i));
+    for (size_t k = 0; k < s::LANES; ++k) {
+      result += total[k];
+    }
+    return static_cast<T>(result);
+  }
+};
+
+template <>
+struct kernel<clamp_op> {
+  template <typename T>
+  static void run(const T* p, size_t n, T lo, T hi, T* out) noexcept {
+    using s = simd<T>;
+    typename s::vec v;
+    size_t i = 0;
+    for (; i + s::LANES <= n; i += s::LANES) {
+      SOCOW_SIMD_LOAD(v, p + i);
+      v = v < lo ? lo : v;
+      v = hi < v ? hi : v;
+      std::memcpy(out + i, &v, sizeof(v));
+    }
+    clamp_op::scalar(p + i, n - i, lo, hi, out + i);
+  }
+};
+
+template <>
+struct kernel<add_op> {
+  template <typename T>
+  static void run(const T* a, const T* b, size_t n, T* out) noexcept {
+    using s = simd<wrapping<T>>;
+    typename s::vec x, y;
+    size_t i = 0;
+    for (; i + s::LANES <= n; i += s::LANES) {
+      SOCOW_SIMD_LOAD(x, a + i);
+      SOCOW_SIMD_LOAD(y, b + i);
+      x += y;
+      std::memcpy(out + i, &x, sizeof(x));
+    }
+    add_op::scalar(a + i, b + i, n - i, out + i);
+  }
+};
+
+#undef SOCOW_SIMD_LOAD
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "socow-vector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Vectorized algorithms for socow_vectors of arithmetic types. They take the vector by const reference and read
+// its buffer directly, so they never unshare it and don't pay for the checks in operator[]. The instruction set is
+// picked at runtime: the best one the CPU supports, but not above socow_simd_config::max_level.
+//
+// Sums and dot products are accumulated in several lanes, so for floating-point elements the result may differ
+// from std::accumulate in the last bits. Integer sums, dot products and socow_add wrap around on overflow, at
+// every instruction set. With NaNs the results of socow_min and socow_max are unspecified.
+
+enum class socow_simd_level { scalar, sse2, avx2, avx512 };
+
+struct socow_simd_config {
+  inline static std::atomic<socow_simd_level> max_level{socow_simd_level::avx512};
+};
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define SOCOW_HAS_SIMD 1
+#else
+#define SOCOW_HAS_SIMD 0
+#endif
+
+namespace socow_detail {
+
+template <typename T>
+concept simd_element = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+inline socow_simd_level detect_simd_level() noexcept {
+#if SOCOW_HAS_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")) {
+    return socow_simd_level::avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return socow_simd_level::avx2;
+  }
+  return socow_simd_level::sse2;
+#else
+  return socow_simd_level::scalar;
+#endif
+}
+
+inline socow_simd_level simd_level() noexcept {
+  static const socow_simd_level supported = detect_simd_level();
+  return std::min(supported, socow_simd_config::max_level.load(std::memory_order_relaxed));
+}
+
+// The type integer sums are taken in: they wrap around, where signed T would overflow.
+template <typename T>
+using wrapping = typename std::conditional_t<std::is_integral_v<T>, std::make_unsigned<T>, std::type_identity<T>>::type;
+
+// The type integer products are taken in: types narrower than int would be promoted to int and could overflow it.
+template <typename T>
+using wrapping_product = std::common_type_t<wrapping<T>, unsigned>;
+
+// The scalar versions of the algorithms. The vectorized ones are in socow-algorithm-kernels.h.
+
+struct find_op {
+  template <typename T>
+  static size_t scalar(const T* p, size_t n, T value) noexcept {
+    return static_cast<size_t>(std::find(p, p + n, value) - p);
+  }
+};
+
+struct count_op {
+  template <typename T>
+  static size_t scalar(const T* p, size_t n, T value) noexcept {
+    return static_cast<size_t>(std::count(p, p + n, value));
+  }
+};
+
+template <bool MIN>
+struct extremum_op {
+  template <typename T>
+  static T scalar(const T* p, size_t n) noexcept {
+    return MIN ? *std::min_element(p, p + n) : *std::max_element(p, p + n);
+  }
+};
+
+struct dot_op {
+  // With b == nullptr it is the sum of a.
+  template <typename T>
+  static T scalar(const T* a, const T* b, size_t n) noexcept {
+    using P = wrapping_product<T>;
+    wrapping<T> sum = 0;
+    if (b) {
+      for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<P>(a[i]) * static_cast<P>(b[i]);
+      }
+    } else {
+      for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<wrapping<T>>(a[i]);
+      }
+    }
+    return static_cast<T>(sum);
+  }
+};
+
+struct clamp_op {
+  template <typename T>
+  static void scalar(const T* p, size_t n, T lo, T hi, T* out) noexcept {
+    std::transform(p, p + n, out, [lo, hi](T x) { return std::clamp(x, lo, hi); });
+  }
+};
+
+struct add_op {
+  template <typename T>
+  static void scalar(const T* a, const T* b, size_t n, T* out) noexcept {
+    std::transform(a, a + n, b, out, [](T x, T y) {
+      return static_cast<T>(static_cast<wrapping_product<T>>(x) + static_cast<wrapping_product<T>>(y));
+    });
+  }
+};
+
+} // namespace socow_detail
+
+#if SOCOW_HAS_SIMD
+// The target has to be on the kernels themselves: GCC picks the instructions for vector extensions when it compiles
+// a function, before inlining, so a kernel inlined into a target("avx2") function would still be scalarized.
+#define SOCOW_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define SOCOW_SIMD_TARGET_PUSH(isa) SOCOW_PRAGMA(clang attribute push(__attribute__((target(isa))), apply_to = function))
+#define SOCOW_SIMD_TARGET_POP() SOCOW_PRAGMA(clang attribute pop)
+#else
+#define SOCOW_SIMD_TARGET_PUSH(isa) SOCOW_PRAGMA(GCC push_options) SOCOW_PRAGMA(GCC target(isa))
+#define SOCOW_SIMD_TARGET_POP() SOCOW_PRAGMA(GCC pop_options)
+#endif
+
+SOCOW_SIMD_TARGET_PUSH("sse2")
+namespace socow_detail::simd_sse2 {
+inline constexpr size_t BYTES = 16;
+#include "socow-algorithm-kernels.h"
+} // namespace socow_detail::simd_sse2
+SOCOW_SIMD_TARGET_POP()
+
+SOCOW_SIMD_TARGET_PUSH("avx2")
+namespace socow_detail::simd_avx2 {
+inline constexpr size_t BYTES = 32;
+#include "socow-algorithm-kernels.h"
+} // namespace socow_detail::simd_avx2
+SOCOW_SIMD_TARGET_POP()
+
+SOCOW_SIMD_TARGET_PUSH("avx512f,avx512bw,avx512dq")
+namespace socow_detail::simd_avx512 {
+inline constexpr size_t BYTES = 64;
+#include "socow-algorithm-kernels.h"
+} // namespace socow_detail::simd_avx512
+SOCOW_SIMD_TARGET_POP()
+
+#undef SOCOW_SIMD_TARGET_POP
+#undef SOCOW_SIMD_TARGET_PUSH
+#undef SOCOW_PRAGMA
+#endif
+
+namespace socow_detail {
+
+template <typename Op, typename... Args>
+auto simd_dispatch(Args... args) noexcept {
+#if SOCOW_HAS_SIMD
+  switch (simd_level()) {
+  case socow_simd_level::avx512:
+    return simd_avx512::kernel<Op>::run(args...);
+  case socow_simd_level::avx2:
+    return simd_avx2::kernel<Op>::run(args...);
+  case socow_simd_level::sse2:
+    return simd_sse2::kernel<Op>::run(args...);
+  default:
+    break;
+  }
+#endif
+  return Op::scalar(args...);
+}
+
+} // namespace socow_detail
+
+// Search and counting.
+
+template <socow_detail::simd_element T, size_t N>
+typename socow_vector<T, N>::const_iterator socow_find(const socow_vector<T, N>& v, std::type_identity_t<T> value) noexcept {
+  return v.begin() + socow_detail::simd_dispatch<socow_detail::find_op>(v.data(), v.size(), value);
+}
+
+template <socow_detail::simd_element T, size_t N>
+size_t socow_count(const socow_vector<T, N>& v, std::type_identity_t<T> value) noexcept {
+  return socow_detail::simd_dispatch<socow_detail::count_op>(v.data(), v.size(), value);
+}
+
+// Reductions. socow_min and socow_max require a non-empty vector.
+
+template <socow_detail::simd_element T, size_t N>
+T socow_min(const socow_vector<T, N>& v) noexcept {
+  assert(!v.empty());
+  return socow_detail::simd_dispatch<socow_detail::extremum_op<true>>(v.data(), v.size());
+}
+
+template <socow_detail::simd_element T, size_t N>
+T socow_max(const socow_vector<T, N>& v) noexcept {
+  assert(!v.empty());
+  return socow_detail::simd_dispatch<socow_detail::extremum_op<false>>(v.data(), v.size());
+}
+
+template <socow_detail::simd_element T, size_t N>
+T socow_sum(const socow_vector<T, N>& v) noexcept {
+  return socow_detail::simd_dispatch<socow_detail::dot_op>(v.data(), static_cast<const T*>(nullptr), v.size());
+}
+
+template <socow_detail::simd_element T, size_t N>
+T socow_dot(const socow_vector<T, N>& a, const socow_vector<T, N>& b) noexcept {
+  assert(a.size() == b.size());
+  return socow_detail::simd_dispatch<socow_detail::dot_op>(a.data(), b.data(), a.size());
+}
+
+// Elementwise transforms into a new vector.
+
+template <socow_detail::simd_element T, size_t N>
+socow_vector<T, N> socow_clamp(const socow_vector<T, N>& v, std::type_identity_t<T> lo, std::type_identity_t<T> hi) {
+  assert(!(hi < lo));
+  auto result = socow_vector<T, N>::for_overwrite(v.size());
+  socow_detail::simd_dispatch<socow_detail::clamp_op>(v.data(), v.size(), lo, hi, result.data());
+  return result;
+}
+
+template <socow_detail::simd_element T, size_t N>
+socow_vector<T, N> socow_add(const socow_vector<T, N>& a, const socow_vector<T, N>& b) {
+  assert(a.size() == b.size());
+  auto result = socow_vector<T, N>::for_overwrite(a.size());
+  socow_detail::simd_dispatch<socow_detail::add_op>(a.data(), b.data(), a.size(), result.data());
+  return result;
+}
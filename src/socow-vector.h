@@ -1,339 +1,2896 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
+
+#if __has_include(<unistd.h>) && __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#include <unistd.h>
+#define SOCOW_HAS_POSIX_IO 1
+#else
+#define SOCOW_HAS_POSIX_IO 0
+#endif
+
+#if SOCOW_HAS_POSIX_IO && __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define SOCOW_HAS_MMAP 1
+#else
+#define SOCOW_HAS_MMAP 0
+#endif
+
+#if SOCOW_HAS_MMAP && defined(__linux__) && defined(MFD_CLOEXEC)
+#define SOCOW_HAS_MEMFD 1
+#else
+#define SOCOW_HAS_MEMFD 0
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && __has_include(<immintrin.h>)
+#include <immintrin.h>
+#define SOCOW_HAS_STREAMING_COPY 1
+#else
+#define SOCOW_HAS_STREAMING_COPY 0
+#endif
+
+#if SOCOW_HAS_POSIX_IO && defined(__linux__) && __has_include(<poll.h>)
+#include <fcntl.h>
+#include <poll.h>
+#define SOCOW_HAS_PSI 1
+#else
+#define SOCOW_HAS_PSI 0
+#endif
+
+// USDT probes for bpftrace and perf, provider socow_vector: unshare, spill, grow, shrink_to_small and release. Each
+// one gets the vector's size, the capacities involved and the element size. Unless a tracer is attached, a probe is
+// a single nop. SOCOW_NO_USDT turns them off.
+#if defined(__linux__) && __has_include(<sys/sdt.h>) && !defined(SOCOW_NO_USDT)
+#include <sys/sdt.h>
+#define SOCOW_HAS_USDT 1
+#define SOCOW_PROBE(...)                                                                                               \
+  do {                                                                                                                 \
+    _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wold-style-cast\"")                              \
+        STAP_PROBEV(socow_vector, __VA_ARGS__);                                                                        \
+    _Pragma("GCC diagnostic pop")                                                                                      \
+  } while (false)
+#else
+#define SOCOW_HAS_USDT 0
+#define SOCOW_PROBE(...) ((void)0)
+#endif
+
+// Define SOCOW_STATS to 1 to count what socow_vectors do, see socow_stats.
+#ifndef SOCOW_STATS
+#define SOCOW_STATS 0
+#endif
+
+// Define SOCOW_CALL_SITES to 1 to attribute unshares and reallocations to the lines that caused them: operator[],
+// data(), begin(), end(), insert, push_back and reserve then take the caller's std::source_location, see
+// socow_report_call_sites. It changes their signatures, so the whole program must agree on it.
+#ifndef SOCOW_CALL_SITES
+#define SOCOW_CALL_SITES 0
+#endif
+
+#if SOCOW_CALL_SITES
+#include <source_location>
+#define SOCOW_LOCATION std::source_location call_site = std::source_location::current()
+#define SOCOW_AND_LOCATION , SOCOW_LOCATION
+#define SOCOW_INDEX socow_detail::located_index
+#define SOCOW_ENTER(location) socow_detail::call_site_scope entered_call_site(location)
+#else
+#define SOCOW_LOCATION
+#define SOCOW_AND_LOCATION
+#define SOCOW_INDEX size_t
+#define SOCOW_ENTER(location)
+#endif
+
+// Define SOCOW_BUFFER_REGISTRY to 1 in every translation unit to make socow_dump and socow_summary available.
+// It changes the layout of socow_vector, so the whole program must agree on it.
+#ifndef SOCOW_BUFFER_REGISTRY
+#define SOCOW_BUFFER_REGISTRY 0
+#endif
+
+#if SOCOW_BUFFER_REGISTRY && __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define SOCOW_HAS_BACKTRACE 1
+#else
+#define SOCOW_HAS_BACKTRACE 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SOCOW_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define SOCOW_NOINLINE __declspec(noinline)
+#else
+#define SOCOW_NOINLINE
+#endif
+
+struct socow_config {
+  // Heap buffers of trivially copyable elements taking at least this many bytes are backed by a memfd, which
+  // makes unsharing them copy only the pages written afterwards. 0 disables the paged mode.
+  inline static std::atomic<size_t> paged_cow_threshold{0};
+
+  // Elements copied into the next buffer, or destroyed in the previous one, by every push_back while an
+  // incremental growth is in progress.
+  inline static std::atomic<size_t> incremental_growth_step{32};
+
+  // Unsharing or reallocating at least this many bytes copies the elements on several threads. 0 disables it.
+  inline static std::atomic<size_t> parallel_copy_threshold{0};
+
+  // Threads used by a parallel copy, including the calling one. 0 means std::thread::hardware_concurrency(). The
+  // other threads are started by the first copy that needs them and kept until exit.
+  inline static std::atomic<size_t> parallel_copy_threads{0};
+
+  // Copies of trivially copyable elements taking at least this many bytes bypass the cache with non-temporal
+  // stores, so that they don't evict the data of other threads. 0 disables them; only x86-64 supports them.
+  inline static std::atomic<size_t> streaming_copy_threshold{0};
+};
+
+// Whether the elements may be copied on other threads, by a parallel copy (see parallel_copy_threshold) or by
+// socow_vector::unshare_async. Copying a nested socow_vector changes its non-atomic reference count, so only
+// trivially copyable types are copied there unless this is specialized for a type whose copy constructor is
+// thread-safe.
+template <typename T>
+struct socow_thread_copyable : std::is_trivially_copyable<T> {};
+
+class socow_format_error : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// Layout of a serialized socow_vector: this header followed by `count * element_size` bytes of payload.
+struct socow_file_header {
+  static constexpr char MAGIC[8] = {'S', 'O', 'C', 'O', 'W', 'V', 'E', 'C'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint32_t ENDIAN_TAG = 0x01020304;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t endian_tag;
+  uint64_t element_size;
+  uint64_t count;
+  uint64_t checksum;
+  // Process-shared count of attach_shared() mappings; only maintained inside shared memory segments.
+  uint64_t attachments;
+  uint64_t reserved[2];
+};
+
+static_assert(sizeof(socow_file_header) == 64);
+
+namespace socow_detail {
+
+inline uint64_t checksum(const void* data, size_t bytes) noexcept {
+  constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ULL;
+  const auto* p = static_cast<const unsigned char*>(data);
+  uint64_t lanes[4] = {PRIME, PRIME + 1, PRIME + 2, PRIME + 3};
+  size_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    for (size_t j = 0; j < 4; ++j) {
+      uint64_t word;
+      std::memcpy(&word, p + i + 8 * j, 8);
+      lanes[j] = (lanes[j] ^ word) * PRIME;
+    }
+  }
+  for (size_t j = 0; i + 8 <= bytes; i += 8, ++j) {
+    uint64_t word;
+    std::memcpy(&word, p + i, 8);
+    lanes[j] = (lanes[j] ^ word) * PRIME;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, p + i, bytes - i);
+  uint64_t hash = bytes;
+  for (uint64_t lane : lanes) {
+    hash = (hash ^ lane) * PRIME;
+    hash ^= hash >> 29;
+  }
+  return ((hash ^ tail) * PRIME) ^ (hash >> 32);
+}
+
+#if SOCOW_HAS_STREAMING_COPY
+// Kernels for streaming_copy: `to` is 64-byte aligned and `bytes` is a multiple of 64. The source is prefetched a
+// few cache lines ahead with the non-temporal hint as well.
+constexpr size_t STREAMING_PREFETCH_DISTANCE = 512;
+
+using streaming_kernel = void (*)(char* to, const char* from, size_t bytes) noexcept;
+
+inline void streaming_copy_sse2(char* to, const char* from, size_t bytes) noexcept {
+  for (size_t i = 0; i < bytes; i += 64) {
+    _mm_prefetch(from + i + STREAMING_PREFETCH_DISTANCE, _MM_HINT_NTA);
+    for (size_t j = 0; j < 64; j += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i + j));
+      _mm_stream_si128(reinterpret_cast<__m128i*>(to + i + j), v);
+    }
+  }
+}
+
+__attribute__((target("avx2"))) inline void streaming_copy_avx2(char* to, const char* from, size_t bytes) noexcept {
+  for (size_t i = 0; i < bytes; i += 64) {
+    _mm_prefetch(from + i + STREAMING_PREFETCH_DISTANCE, _MM_HINT_NTA);
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i + 32));
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(to + i), a);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(to + i + 32), b);
+  }
+}
+
+__attribute__((target("avx512f"))) inline void streaming_copy_avx512(char* to, const char* from,
+                                                                     size_t bytes) noexcept {
+  for (size_t i = 0; i < bytes; i += 64) {
+    _mm_prefetch(from + i + STREAMING_PREFETCH_DISTANCE, _MM_HINT_NTA);
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(to + i), _mm512_loadu_si512(from + i));
+  }
+}
+
+inline streaming_kernel select_streaming_kernel() noexcept {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return &streaming_copy_avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return &streaming_copy_avx2;
+  }
+  return &streaming_copy_sse2;
+}
+
+// memcpy with non-temporal stores for the 64-byte aligned part of the destination.
+inline void streaming_copy(void* dst, const void* src, size_t bytes, streaming_kernel kernel = nullptr) noexcept {
+  static const streaming_kernel best = select_streaming_kernel();
+  auto* to = static_cast<char*>(dst);
+  const auto* from = static_cast<const char*>(src);
+  size_t head = std::min(bytes, (64 - reinterpret_cast<uintptr_t>(to) % 64) % 64);
+  std::memcpy(to, from, head);
+  size_t body = (bytes - head) & ~size_t(63);
+  (kernel ? kernel : best)(to + head, from + head, body);
+  _mm_sfence();
+  std::memcpy(to + head + body, from + head + body, bytes - head - body);
+}
+#endif
+
+inline socow_file_header make_header(size_t element_size, size_t count, const void* payload) noexcept {
+  socow_file_header header{};
+  std::memcpy(header.magic, socow_file_header::MAGIC, sizeof(header.magic));
+  header.version = socow_file_header::VERSION;
+  header.endian_tag = socow_file_header::ENDIAN_TAG;
+  header.element_size = element_size;
+  header.count = count;
+  header.checksum = checksum(payload, element_size * count);
+  return header;
+}
+
+inline size_t validate_header(const socow_file_header& header, size_t element_size) {
+  if (std::memcmp(header.magic, socow_file_header::MAGIC, sizeof(header.magic)) != 0) {
+    throw socow_format_error("socow_vector: bad magic");
+  }
+  if (header.version != socow_file_header::VERSION) {
+    throw socow_format_error("socow_vector: unsupported version");
+  }
+  if (header.endian_tag != socow_file_header::ENDIAN_TAG) {
+    throw socow_format_error("socow_vector: foreign byte order");
+  }
+  if (header.element_size != element_size) {
+    throw socow_format_error("socow_vector: element size mismatch");
+  }
+  if (header.count > SIZE_MAX / element_size) {
+    throw socow_format_error("socow_vector: element count overflows");
+  }
+  return header.count;
+}
+
+inline void verify_checksum(const socow_file_header& header, const void* payload) {
+  if (checksum(payload, header.element_size * header.count) != header.checksum) {
+    throw socow_format_error("socow_vector: checksum mismatch");
+  }
+}
+
+#if SOCOW_HAS_POSIX_IO
+inline void write_all(int fd, iovec* iov, int iovcnt, off_t offset = -1) {
+  while (iovcnt > 0) {
+    ssize_t written = offset < 0 ? ::writev(fd, iov, iovcnt) : ::pwritev(fd, iov, iovcnt, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "socow_vector: writev");
+    }
+    if (offset >= 0) {
+      offset += written;
+    }
+    auto left = static_cast<size_t>(written);
+    while (iovcnt > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+inline void read_all(int fd, void* data, size_t bytes) {
+  auto* p = static_cast<char*>(data);
+  while (bytes > 0) {
+    ssize_t got = ::read(fd, p, bytes);
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "socow_vector: read");
+    }
+    if (got == 0) {
+      throw socow_format_error("socow_vector: unexpected end of file");
+    }
+    p += got;
+    bytes -= static_cast<size_t>(got);
+  }
+}
+#endif
+
+#if SOCOW_HAS_MMAP
+struct file_mapping {
+  file_mapping(void* address, size_t length) noexcept : address(address), length(length) {}
+
+  file_mapping(file_mapping&& other) noexcept : address(std::exchange(other.address, nullptr)), length(other.length) {}
+
+  ~file_mapping() {
+    if (address) {
+      ::munmap(address, length);
+    }
+  }
+
+  void* address;
+  size_t length;
+};
+
+inline file_mapping map_serialized_file(const char* path) {
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "socow_vector: open");
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), "socow_vector: fstat");
+  }
+  auto length = static_cast<size_t>(st.st_size);
+  if (length < sizeof(socow_file_header)) {
+    ::close(fd);
+    throw socow_format_error("socow_vector: truncated header");
+  }
+  void* address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    throw std::system_error(error, std::generic_category(), "socow_vector: mmap");
+  }
+  return {address, length};
+}
+#endif
+
+#if SOCOW_HAS_MEMFD
+// Reference counted by the buffers mapping it; like the rest of socow_vector this count is not thread-safe.
+struct memfd_file {
+  static memfd_file* create(size_t bytes) {
+    auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t length = std::max<size_t>((bytes + page - 1) / page * page, page);
+    int fd = ::memfd_create("socow-vector-paged", MFD_CLOEXEC);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "socow_vector: memfd_create");
+    }
+    if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "socow_vector: ftruncate");
+    }
+    return new memfd_file{fd, length, 0};
+  }
+
+  // Takes a mapping reference, which the caller gives back with release() also when mapping fails.
+  void* map(int flags) {
+    ++mappings;
+    void* address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (address == MAP_FAILED) {
+      int error = errno;
+      release();
+      throw std::system_error(error, std::generic_category(), "socow_vector: mmap");
+    }
+    return address;
+  }
+
+  // Atomically replaces a MAP_SHARED mapping of the file at `address` by a MAP_PRIVATE one with the same contents.
+  bool remap_private(void* address) noexcept {
+    void* fresh = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (fresh == MAP_FAILED) {
+      return false;
+    }
+    if (::mremap(fresh, length, length, MREMAP_MAYMOVE | MREMAP_FIXED, address) == MAP_FAILED) {
+      ::munmap(fresh, length);
+      return false;
+    }
+    return true;
+  }
+
+  void release() noexcept {
+    if (--mappings == 0) {
+      ::close(fd);
+      delete this;
+    }
+  }
+
+  int fd;
+  size_t length;
+  size_t mappings;
+};
+
+// The attachment counter is a plain word of the mapped header, updated with the builtins: std::atomic_ref is
+// missing from older standard libraries, and a lock-free atomic on it is address-free across processes.
+struct shared_mapping {
+  static_assert(__atomic_always_lock_free(sizeof(uint64_t), nullptr), "the attachment counter must be address-free");
+
+  shared_mapping(file_mapping mapping, socow_file_header* header) noexcept
+      : mapping(std::move(mapping)),
+        header(header) {
+    __atomic_fetch_add(&header->attachments, 1, __ATOMIC_ACQ_REL);
+  }
+
+  shared_mapping(const shared_mapping&) = delete;
+
+  ~shared_mapping() {
+    __atomic_fetch_sub(&header->attachments, 1, __ATOMIC_ACQ_REL);
+  }
+
+  file_mapping mapping;
+  socow_file_header* header;
+};
+
+inline std::pair<file_mapping, socow_file_header*> map_shared_segment(int fd, off_t offset, size_t element_size) {
+  if (offset < 0 || offset % sizeof(socow_file_header) != 0) {
+    throw std::invalid_argument("socow_vector: segment offset must be a multiple of 64");
+  }
+  socow_file_header header;
+  ssize_t got = ::pread(fd, &header, sizeof(header), offset);
+  if (got < 0) {
+    throw std::system_error(errno, std::generic_category(), "socow_vector: pread");
+  }
+  if (static_cast<size_t>(got) != sizeof(header)) {
+    throw socow_format_error("socow_vector: truncated header");
+  }
+  size_t count = validate_header(header, element_size);
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    throw std::system_error(errno, std::generic_category(), "socow_vector: fstat");
+  }
+  size_t end = sizeof(header) + count * element_size;
+  if (static_cast<size_t>(st.st_size - offset) < end) {
+    throw socow_format_error("socow_vector: truncated payload");
+  }
+  auto page = static_cast<off_t>(::sysconf(_SC_PAGESIZE));
+  off_t base = offset / page * page;
+  auto delta = static_cast<size_t>(offset - base);
+  void* address = ::mmap(nullptr, delta + end, PROT_READ | PROT_WRITE, MAP_SHARED, fd, base);
+  if (address == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "socow_vector: mmap");
+  }
+  return {file_mapping(address, delta + end), reinterpret_cast<socow_file_header*>(static_cast<char*>(address) + delta)};
+}
+#endif
+
+// The vectors that opted into socow_trim with set_trimmable, by address.
+struct trim_entry {
+  // The heap bytes that trimming the vector would give back, 0 if it can't be trimmed.
+  size_t (*reclaimable)(const void* vector) noexcept;
+  void (*trim)(void* vector);
+};
+
+// Recursive, since trimming a vector may destroy trimmable vectors among its elements.
+struct trim_registry {
+  std::recursive_mutex mutex;
+  std::unordered_map<void*, trim_entry> entries;
+};
+
+inline trim_registry& trimmable_vectors() {
+  static trim_registry registry;
+  return registry;
+}
+
+// The threads of parallel copies, started on first use and joined at exit. One copy uses them at a time; a copy
+// that finds them busy runs on its own thread.
+class worker_pool {
+public:
+  worker_pool() = default;
+
+  worker_pool(const worker_pool&) = delete;
+
+  ~worker_pool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Calls task(i) for every i in [0, count), on the calling thread and up to count - 1 workers, and returns when
+  // all calls did. `task` must not throw.
+  template <typename Task>
+  void run(size_t count, Task& task) {
+    run(count, [](void* context, size_t i) { (*static_cast<Task*>(context))(i); }, &task);
+  }
+
+private:
+  void run(size_t count, void (*function)(void*, size_t), void* context) {
+    if (busy.exchange(true, std::memory_order_acquire)) {
+      for (size_t i = 0; i < count; ++i) {
+        function(context, i);
+      }
+      return;
+    }
+    std::unique_lock lock(mutex);
+    while (threads.size() + 1 < count) {
+      try {
+        threads.emplace_back(&worker_pool::work, this);
+      } catch (...) {
+        break;
+      }
+    }
+    current = {function, context, 0, count, count};
+    wake.notify_all();
+    take_tasks(lock);
+    done.wait(lock, [this] { return current.remaining == 0; });
+    current = {};
+    busy.store(false, std::memory_order_release);
+  }
+
+  void work() {
+    std::unique_lock lock(mutex);
+    while (true) {
+      wake.wait(lock, [this] { return stopping || current.next < current.count; });
+      if (stopping) {
+        return;
+      }
+      take_tasks(lock);
+    }
+  }
+
+  void take_tasks(std::unique_lock<std::mutex>& lock) {
+    job_t& job = current;
+    while (job.next < job.count) {
+      size_t i = job.next++;
+      lock.unlock();
+      job.function(job.context, i);
+      lock.lock();
+      if (--job.remaining == 0) {
+        done.notify_all();
+      }
+    }
+  }
+
+  struct job_t {
+    void (*function)(void*, size_t) = nullptr;
+    void* context = nullptr;
+    size_t next = 0;
+    size_t count = 0;
+    size_t remaining = 0;
+  };
+
+  std::atomic<bool> busy = false;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::vector<std::thread> threads;
+  job_t current;
+  bool stopping = false;
+};
+
+inline worker_pool& copy_workers() {
+  static worker_pool pool;
+  return pool;
+}
+
+} // namespace socow_detail
+
+enum class socow_counter : size_t {
+  // Copies and assignments that shared a heap buffer instead of copying the elements.
+  shared_copies,
+  // Private copies of a shared buffer made before a modification, and the bytes of elements they copied.
+  unshares,
+  unshare_bytes,
+  // Moves from the small buffer to a heap buffer, and back.
+  spills,
+  shrinks_to_small,
+  // Moves from a heap buffer to another one of different capacity, and their capacities in bytes: the ratio of
+  // the two sums is the average growth factor.
+  reallocations,
+  reallocated_from_bytes,
+  reallocated_to_bytes,
+  // Heap buffers and memfds allocated and freed by socow_vector itself, in bytes.
+  heap_bytes_allocated,
+  heap_bytes_freed,
+  // The capacity that freed heap buffers never used.
+  wasted_capacity_bytes,
+  count
+};
+
+namespace socow_detail {
+
+inline constexpr size_t COUNTERS = static_cast<size_t>(socow_counter::count);
+
+// Every thread counts into its own block, so counting is a plain load and store. The blocks of running threads
+// are linked into a list, and a finishing thread adds its counts to `retired`.
+struct stats_block {
+  std::atomic<uint64_t> values[COUNTERS] = {};
+  stats_block* next = nullptr;
+};
+
+struct stats_registry {
+  std::mutex mutex;
+  stats_block* live = nullptr;
+  std::array<uint64_t, COUNTERS> retired = {};
+};
+
+inline stats_registry& stats() {
+  static stats_registry registry;
+  return registry;
+}
+
+struct thread_stats {
+  thread_stats() noexcept {
+    std::lock_guard lock(stats().mutex);
+    block.next = stats().live;
+    stats().live = &block;
+  }
+
+  ~thread_stats() {
+    std::lock_guard lock(stats().mutex);
+    stats_block** link = &stats().live;
+    while (*link != &block) {
+      link = &(*link)->next;
+    }
+    *link = block.next;
+    for (size_t i = 0; i < COUNTERS; ++i) {
+      stats().retired[i] += block.values[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  stats_block block;
+};
+
+inline void count(socow_counter counter, uint64_t n) noexcept {
+  thread_local thread_stats local;
+  auto& value = local.block.values[static_cast<size_t>(counter)];
+  value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline thread_local size_t no_copy_depth = 0;
+inline std::atomic<uint64_t> no_copy_violations{0};
+
+// Called before a vector allocates or clones a heap buffer of `bytes`.
+inline void check_no_copy([[maybe_unused]] const char* what, [[maybe_unused]] size_t bytes) noexcept {
+  if (no_copy_depth == 0) [[likely]] {
+    return;
+  }
+#ifdef NDEBUG
+  no_copy_violations.fetch_add(1, std::memory_order_relaxed);
+#else
+  std::cerr << "socow_vector: " << what << " a buffer of " << bytes << " bytes inside socow_no_copy_scope\n";
+  std::abort();
+#endif
+}
+
+#if SOCOW_CALL_SITES
+// An index that remembers where it was written, since operator[] can't have a defaulted parameter of its own.
+struct located_index {
+  located_index(size_t value, std::source_location call_site = std::source_location::current()) noexcept
+      : value(value),
+        call_site(call_site) {}
+
+  operator size_t() const noexcept {
+    return value;
+  }
+
+  size_t value;
+  std::source_location call_site;
+};
+
+struct call_site_totals {
+  std::source_location location;
+  uint64_t events = 0;
+  uint64_t bytes = 0;
+  std::chrono::nanoseconds time{0};
+};
+
+struct call_site_registry {
+  std::mutex mutex;
+  std::map<std::tuple<std::string, uint_least32_t, uint_least32_t>, call_site_totals> sites;
+};
+
+inline call_site_registry& call_sites() {
+  static call_site_registry registry;
+  return registry;
+}
+
+inline thread_local bool inside_call_site = false;
+inline thread_local std::source_location current_call_site;
+
+// Makes `location` the call site of the costly events until the end of the scope. An entry point called from
+// another one, like insert from push_back, keeps the outer location.
+class call_site_scope {
+public:
+  explicit call_site_scope(const std::source_location& location) noexcept : outermost(!inside_call_site) {
+    if (outermost) {
+      inside_call_site = true;
+      current_call_site = location;
+    }
+  }
+
+  call_site_scope(const call_site_scope&) = delete;
+
+  ~call_site_scope() {
+    if (outermost) {
+      inside_call_site = false;
+    }
+  }
+
+private:
+  bool outermost;
+};
+
+// Events outside of the entry points go to a location with an empty file name.
+inline void record_costly_event(size_t bytes, std::chrono::nanoseconds time) noexcept {
+  std::source_location location = inside_call_site ? current_call_site : std::source_location();
+  try {
+    std::lock_guard lock(call_sites().mutex);
+    auto& totals = call_sites().sites[{location.file_name(), location.line(), location.column()}];
+    totals.location = location;
+    ++totals.events;
+    totals.bytes += bytes;
+    totals.time += time;
+  } catch (...) {
+  }
+}
+#endif
+
+#if SOCOW_BUFFER_REGISTRY
+// The return addresses on the stack where a heap buffer was allocated.
+struct call_site {
+  static constexpr int FRAMES = 10;
+
+  void capture() noexcept {
+#if SOCOW_HAS_BACKTRACE
+    frames = ::backtrace(addresses, FRAMES);
+#endif
+  }
+
+  void* addresses[FRAMES];
+  int frames = 0;
+};
+
+struct buffer_info {
+  const void* buffer;
+  size_t element_size;
+  size_t capacity;
+  // The vectors and unshare_async tasks holding the buffer.
+  size_t owners;
+  // The elements constructed in the buffer, the largest size among its owners.
+  size_t initialized;
+  bool external;
+  const call_site* site;
+};
+
+// Every live socow_vector is linked into one list, so that their heap buffers can be found.
+struct registry_node {
+  const void* vector;
+  // Describes the heap buffer of `vector`; returns false if it has none.
+  bool (*describe)(const void* vector, buffer_info& info) noexcept;
+  registry_node* prev = nullptr;
+  registry_node* next = nullptr;
+};
+
+struct vector_registry {
+  std::mutex mutex;
+  registry_node head{nullptr, nullptr, &head, &head};
+
+  void link(registry_node* node) noexcept {
+    std::lock_guard lock(mutex);
+    node->prev = head.prev;
+    node->next = &head;
+    head.prev->next = node;
+    head.prev = node;
+  }
+
+  void unlink(registry_node* node) noexcept {
+    std::lock_guard lock(mutex);
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+  }
+
+  std::vector<buffer_info> buffers() {
+    std::unordered_map<const void*, size_t> index;
+    std::vector<buffer_info> result;
+    std::lock_guard lock(mutex);
+    for (registry_node* node = head.next; node != &head; node = node->next) {
+      buffer_info info;
+      if (!node->describe(node->vector, info)) {
+        continue;
+      }
+      auto [it, inserted] = index.emplace(info.buffer, result.size());
+      if (inserted) {
+        result.push_back(info);
+      } else {
+        result[it->second].initialized = std::max(result[it->second].initialized, info.initialized);
+      }
+    }
+    return result;
+  }
+};
+
+inline vector_registry& live_vectors() {
+  static vector_registry registry;
+  return registry;
+}
+
+inline size_t held_bytes(const buffer_info& info) noexcept {
+  return std::max(info.capacity, info.initialized) * info.element_size;
+}
+#endif
+
+} // namespace socow_detail
+
+#if SOCOW_HAS_MEMFD
+inline int socow_create_shared_memory(const char* name = "socow-vector") {
+  int fd = ::memfd_create(name, MFD_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "socow_vector: memfd_create");
+  }
+  return fd;
+}
+
+inline uint64_t socow_shared_attachments(int fd, off_t offset = 0) {
+  socow_file_header header;
+  if (::pread(fd, &header, sizeof(header), offset) != sizeof(header)) {
+    throw socow_format_error("socow_vector: truncated header");
+  }
+  return header.attachments;
+}
+#endif
+
+// Shrinks the buffers of the vectors marked with set_trimmable, the most wasteful first, until their unused
+// capacity is at most `budget` bytes, and returns the number of bytes given back to the heap. Only unique heap
+// buffers that are at least half empty count; those whose elements fit into the small buffer move there. It
+// modifies the vectors, so no other thread may use them meanwhile. A vector that fails to shrink stays as it was.
+inline size_t socow_trim(size_t budget = 0) {
+  auto& registry = socow_detail::trimmable_vectors();
+  std::lock_guard lock(registry.mutex);
+  std::vector<std::pair<size_t, std::pair<void*, socow_detail::trim_entry>>> candidates;
+  size_t unused = 0;
+  for (auto& [vector, entry] : registry.entries) {
+    if (size_t bytes = entry.reclaimable(vector)) {
+      candidates.push_back({bytes, {vector, entry}});
+      unused += bytes;
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](auto& a, auto& b) { return a.first > b.first; });
+  size_t reclaimed = 0;
+  for (auto& [bytes, candidate] : candidates) {
+    if (unused <= budget) {
+      break;
+    }
+    if (!registry.entries.contains(candidate.first)) {
+      continue;
+    }
+    try {
+      candidate.second.trim(candidate.first);
+    } catch (...) {
+      continue;
+    }
+    reclaimed += bytes;
+    unused -= bytes;
+  }
+  return reclaimed;
+}
+
+// The counters of socow_counter summed over all threads, when SOCOW_STATS is defined to 1; otherwise they stay 0.
+struct socow_stats {
+  struct snapshot_t {
+    uint64_t operator[](socow_counter counter) const noexcept {
+      return values[static_cast<size_t>(counter)];
+    }
+
+    std::array<uint64_t, socow_detail::COUNTERS> values = {};
+  };
+
+  static snapshot_t snapshot() {
+    auto& registry = socow_detail::stats();
+    std::lock_guard lock(registry.mutex);
+    snapshot_t result{registry.retired};
+    for (auto* block = registry.live; block; block = block->next) {
+      for (size_t i = 0; i < socow_detail::COUNTERS; ++i) {
+        result.values[i] += block->values[i].load(std::memory_order_relaxed);
+      }
+    }
+    return result;
+  }
+
+  // Writes the counters in the Prometheus text exposition format.
+  static void write_prometheus(std::ostream& out, const snapshot_t& snapshot, const std::string& prefix = "socow_") {
+    static constexpr const char* NAMES[] = {
+        "shared_copies",        "unshares",          "unshare_bytes",         "spills",
+        "shrinks_to_small",     "reallocations",     "reallocated_from_bytes", "reallocated_to_bytes",
+        "heap_bytes_allocated", "heap_bytes_freed",  "wasted_capacity_bytes",
+    };
+    static_assert(std::size(NAMES) == socow_detail::COUNTERS);
+    for (size_t i = 0; i < socow_detail::COUNTERS; ++i) {
+      out << "# TYPE " << prefix << NAMES[i] << "_total counter\n";
+      out << prefix << NAMES[i] << "_total " << snapshot.values[i] << '\n';
+    }
+  }
+};
+
+// Forbids socow_vector to allocate heap buffers on this thread while it exists: an unshare, a reallocation or a
+// spill out of the small buffer aborts with a diagnostic, or with NDEBUG only counts in violations(). Copying,
+// reading and writing unique buffers within their capacity stay allowed. Scopes may nest.
+class socow_no_copy_scope {
+public:
+  socow_no_copy_scope() noexcept {
+    ++socow_detail::no_copy_depth;
+  }
+
+  socow_no_copy_scope(const socow_no_copy_scope&) = delete;
+  socow_no_copy_scope& operator=(const socow_no_copy_scope&) = delete;
+
+  ~socow_no_copy_scope() {
+    --socow_detail::no_copy_depth;
+  }
+
+  // The allocations made inside the scopes of all threads so far.
+  static uint64_t violations() noexcept {
+    return socow_detail::no_copy_violations.load(std::memory_order_relaxed);
+  }
+};
+
+#if SOCOW_CALL_SITES
+struct socow_call_site {
+  std::string file;
+  uint_least32_t line;
+  std::string function;
+  // Unshares and reallocations caused here, the bytes of elements they copied and the time they took.
+  uint64_t events;
+  uint64_t bytes;
+  std::chrono::nanoseconds time;
+};
+
+// The call sites that spent the most time in unshares and reallocations, the slowest first.
+inline std::vector<socow_call_site> socow_top_call_sites(size_t n = 20) {
+  std::vector<socow_call_site> result;
+  {
+    auto& registry = socow_detail::call_sites();
+    std::lock_guard lock(registry.mutex);
+    for (const auto& [key, totals] : registry.sites) {
+      result.push_back({totals.location.file_name(), totals.location.line(), totals.location.function_name(),
+                        totals.events, totals.bytes, totals.time});
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.time > b.time; });
+  result.resize(std::min(n, result.size()));
+  return result;
+}
+
+inline void socow_report_call_sites(std::ostream& out, size_t n = 20) {
+  out << "socow_vector unshares and reallocations by call site:\n";
+  for (const auto& site : socow_top_call_sites(n)) {
+    out << "  " << site.time.count() / 1000 << " us, " << site.events << " events, " << site.bytes << " bytes: "
+        << (site.file.empty() ? "<unknown>" : site.file) << ':' << site.line << " in " << site.function << '\n';
+  }
+}
+
+// Prints the report to std::cerr when the program exits.
+inline void socow_report_call_sites_at_exit(size_t n = 20) {
+  static std::atomic<size_t> top{n};
+  top = n;
+  static bool registered = std::atexit([] { socow_report_call_sites(std::cerr, top); }) == 0;
+  (void)registered;
+}
+
+inline void socow_reset_call_sites() {
+  auto& registry = socow_detail::call_sites();
+  std::lock_guard lock(registry.mutex);
+  registry.sites.clear();
+}
+#endif
+
+#if SOCOW_BUFFER_REGISTRY
+struct socow_heap_summary {
+  size_t buffers = 0;
+  // Held by the heap buffers of all live vectors, counting each shared buffer once.
+  size_t total_bytes = 0;
+  // What the owners of shared buffers would hold on top of that with private copies.
+  size_t shared_bytes_saved = 0;
+  // Capacity past the constructed elements.
+  size_t wasted_bytes = 0;
+  // The number of buffers by the number of their owners.
+  std::map<size_t, size_t> owners_histogram;
+};
+
+// Walks the heap buffers of all live socow_vectors. The vectors shouldn't be modified meanwhile.
+inline socow_heap_summary socow_summary() {
+  socow_heap_summary summary;
+  for (const auto& info : socow_detail::live_vectors().buffers()) {
+    ++summary.buffers;
+    summary.total_bytes += socow_detail::held_bytes(info);
+    summary.shared_bytes_saved += (info.owners - 1) * info.initialized * info.element_size;
+    summary.wasted_bytes += (info.capacity - std::min(info.capacity, info.initialized)) * info.element_size;
+    ++summary.owners_histogram[info.owners];
+  }
+  return summary;
+}
+
+// Writes the summary followed by every heap buffer, the largest first, with the stack where it was allocated.
+inline void socow_dump(std::ostream& out) {
+  socow_heap_summary summary = socow_summary();
+  out << "socow_vector heap buffers: " << summary.buffers << ", bytes: " << summary.total_bytes
+      << ", saved by sharing: " << summary.shared_bytes_saved << ", wasted capacity: " << summary.wasted_bytes << '\n';
+  for (auto [owners, buffers] : summary.owners_histogram) {
+    out << "  " << owners << (owners == 1 ? " owner: " : " owners: ") << buffers << '\n';
+  }
+  auto buffers = socow_detail::live_vectors().buffers();
+  std::sort(buffers.begin(), buffers.end(), [](const auto& a, const auto& b) {
+    return socow_detail::held_bytes(a) > socow_detail::held_bytes(b);
+  });
+  for (const auto& info : buffers) {
+    out << "buffer " << info.buffer << ": " << socow_detail::held_bytes(info) << " bytes, element size "
+        << info.element_size << ", capacity " << info.capacity << ", initialized " << info.initialized << ", owners "
+        << info.owners << (info.external ? ", external" : "") << '\n';
+#if SOCOW_HAS_BACKTRACE
+    char** symbols = ::backtrace_symbols(info.site->addresses, info.site->frames);
+    for (int i = 0; symbols && i < info.site->frames; ++i) {
+      out << "    " << symbols[i] << '\n';
+    }
+    std::free(symbols);
+#endif
+  }
+}
+#endif
+
+#if SOCOW_HAS_PSI
+// Calls `on_pressure` on a thread of its own every time the tasks covered by a PSI file stall on memory for at
+// least `stall` within `window`: /proc/pressure/memory for the whole system, or memory.pressure of a cgroup v2.
+// The kernel reports at most one event per window. socow_trim touches the vectors, so unless they are idle
+// `on_pressure` should hand the work to the threads that own them. It must not throw.
+class socow_memory_pressure_monitor {
+public:
+  explicit socow_memory_pressure_monitor(std::function<void()> on_pressure,
+                                         std::chrono::microseconds stall = std::chrono::milliseconds(150),
+                                         std::chrono::microseconds window = std::chrono::seconds(1),
+                                         const char* path = "/proc/pressure/memory")
+      : _on_pressure(std::move(on_pressure)) {
+    _fd = ::open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "socow_memory_pressure_monitor: open");
+    }
+    std::string trigger = "some " + std::to_string(stall.count()) + " " + std::to_string(window.count());
+    if (::write(_fd, trigger.c_str(), trigger.size() + 1) < 0 || ::pipe2(_wake, O_CLOEXEC) != 0) {
+      int error = errno;
+      ::close(_fd);
+      throw std::system_error(error, std::generic_category(), "socow_memory_pressure_monitor: trigger");
+    }
+    try {
+      _thread = std::thread([this] { run(); });
+    } catch (...) {
+      close_all();
+      throw;
+    }
+  }
+
+  socow_memory_pressure_monitor(const socow_memory_pressure_monitor&) = delete;
+  socow_memory_pressure_monitor& operator=(const socow_memory_pressure_monitor&) = delete;
+
+  ~socow_memory_pressure_monitor() {
+    char stop = 0;
+    while (::write(_wake[1], &stop, 1) < 0 && errno == EINTR) {
+    }
+    _thread.join();
+    close_all();
+  }
+
+private:
+  void run() noexcept {
+    while (true) {
+      pollfd fds[2] = {{_fd, POLLPRI, 0}, {_wake[0], POLLIN, 0}};
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+      if (fds[1].revents || (fds[0].revents & (POLLERR | POLLNVAL))) {
+        return;
+      }
+      if (fds[0].revents & POLLPRI) {
+        _on_pressure();
+      }
+    }
+  }
+
+  void close_all() noexcept {
+    ::close(_fd);
+    ::close(_wake[0]);
+    ::close(_wake[1]);
+  }
+
+  std::function<void()> _on_pressure;
+  int _fd;
+  int _wake[2];
+  std::thread _thread;
+};
+#endif
 
 template <typename T, size_t SMALL_SIZE>
 class socow_vector {
 public:
-  using value_type = T;
+  using value_type = T;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  using iterator = pointer;
+  using const_iterator = const_pointer;
+
+public:
+  socow_vector() noexcept
+      : _pending(nullptr),
+        _size(0),
+        _is_small_object(true),
+        _incremental_growth(false),
+        _trimmable(false) {
+#if SOCOW_BUFFER_REGISTRY
+    socow_detail::live_vectors().link(&_registry_node);
+#endif
+  }
+
+  explicit socow_vector(size_t capacity) : socow_vector(socow_vector(), capacity) {}
+
+  socow_vector(const socow_vector& other) : socow_vector(other, share_tag()) {
+    if (!_is_small_object) {
+      count(socow_counter::shared_copies);
+    }
+  }
+
+  socow_vector& operator=(const socow_vector& other) {
+    assign_from(other);
+    if (!_is_small_object && this != &other) {
+      count(socow_counter::shared_copies);
+    }
+    return *this;
+  }
+
+  void swap(socow_vector& other) {
+    if (&other == this) {
+      return;
+    }
+    if (_is_small_object && other._is_small_object) {
+      socow_vector& bigger = size() > other.size() ? *this : other;
+      socow_vector& smaller = size() > other.size() ? other : *this;
+      std::uninitialized_copy_n(bigger._static_buffer + smaller.size(), bigger.size() - smaller.size(),
+                                smaller._static_buffer + smaller.size());
+      bigger.destroy_last_n(bigger.size() - smaller.size());
+      std::swap(bigger._is_small_object, smaller._is_small_object);
+      std::swap(bigger._size, smaller._size);
+      std::swap_ranges(bigger._static_buffer, bigger._static_buffer + smaller.size(), smaller._static_buffer);
+    } else {
+      socow_vector& static_or_dynamic_vector = _is_small_object ? *this : other;
+      socow_vector& dynamic_vector = _is_small_object ? other : *this;
+      socow_vector tmp(dynamic_vector, share_tag());
+      dynamic_vector.assign_from(static_or_dynamic_vector);
+      static_or_dynamic_vector.assign_from(tmp);
+    }
+  }
+
+  ~socow_vector() noexcept {
+    if (_is_small_object) {
+      destroy_last_n(size());
+    } else {
+      release_ref();
+      _is_small_object = true;
+    }
+    if (_pending) [[unlikely]] {
+      discard_prepared_unique();
+    }
+    if (_trimmable) [[unlikely]] {
+      unregister_trimmable();
+    }
+#if SOCOW_BUFFER_REGISTRY
+    socow_detail::live_vectors().unlink(&_registry_node);
+#endif
+  }
+
+  reference operator[](SOCOW_INDEX index) {
+    SOCOW_ENTER(index.call_site);
+    assert(index < size());
+    if (growth_storage* growth = active_growth(); growth && owns_growth()) {
+      growth->touch(index);
+      return _heap_buffer->storage[index];
+    }
+    return data()[index];
+  }
+
+  const_reference operator[](SOCOW_INDEX index) const noexcept {
+    assert(index < size());
+    return *(cbegin() + index);
+  }
+
+  pointer data(SOCOW_LOCATION) {
+    SOCOW_ENTER(call_site);
+    if (_is_small_object) {
+      return _static_buffer;
+    } else {
+      ensure_unique();
+      return _heap_buffer->storage;
+    }
+  }
+
+  const_pointer data() const noexcept {
+    return _is_small_object ? _static_buffer : _heap_buffer->storage;
+  }
+
+  size_t size() const noexcept {
+    return _size;
+  }
+
+  reference front() {
+    assert(!empty());
+    return operator[](0);
+  }
+
+  const_reference front() const noexcept {
+    assert(!empty());
+    return operator[](0);
+  }
+
+  reference back() {
+    assert(!empty());
+    return operator[](size() - 1);
+  }
+
+  const_reference back() const noexcept {
+    assert(!empty());
+    return operator[](size() - 1);
+  }
+
+  void push_back(const T& value SOCOW_AND_LOCATION) {
+    SOCOW_ENTER(call_site);
+    if constexpr (std::is_copy_assignable_v<value_type>) {
+      if (_incremental_growth && !is_shared() && !_is_small_object &&
+          (_heap_buffer->external == &GROWTH_OPS || make_writable(_heap_buffer))) [[unlikely]] {
+        push_back_growing(value);
+        return;
+      }
+    }
+    insert(cend(), value);
+  }
+
+  // On a shared buffer it only shrinks this vector: the element stays in the buffer for the other owners.
+  void pop_back() {
+    assert(!empty());
+    if (growth_storage* growth = active_growth(); growth && owns_growth()) {
+      _heap_buffer->storage[--_size].~value_type();
+      growth->touch(_size);
+      return;
+    }
+    erase(cend() - 1);
+  }
+
+  // With incremental growth no push_back copies the whole buffer. Once a heap buffer is nearly full, push_back
+  // allocates the next one and every following push_back copies a few elements into it
+  // (socow_config::incremental_growth_step), so that it is ready when the old one fills up; the elements left in
+  // the old buffer are then destroyed a few at a time as well. The vector only ever shows one of the buffers, so
+  // reading it, const data() and begin() included, changes nothing. A write through operator[], front or back
+  // makes the copy of the elements from there on start over. Any other modification, and non-const data(),
+  // begin() and end() as well since their pointers may write anywhere, makes the whole copy start over. Whatever
+  // the remaining push_backs don't copy again is copied at once by the one that fills the buffer, so iterating a
+  // growing vector through non-const begin() and end() between push_backs brings the O(n) stall back: iterate it
+  // through cbegin() or a const reference. References taken before a push_back must not be written through after
+  // it. The setting belongs to this object and is not copied.
+  void set_incremental_growth(bool enabled) noexcept
+  requires std::is_copy_assignable_v<value_type>
+  {
+    if (!enabled) {
+      stop_growth();
+    }
+    _incremental_growth = enabled;
+  }
+
+  bool incremental_growth() const noexcept {
+    return _incremental_growth;
+  }
+
+  // Lets socow_trim shrink this vector's buffer when it is mostly empty. The setting belongs to this object and is
+  // not copied; the vector unregisters itself when it is destroyed.
+  void set_trimmable(bool enabled) {
+    if (enabled == _trimmable) {
+      return;
+    }
+    auto& registry = socow_detail::trimmable_vectors();
+    std::lock_guard lock(registry.mutex);
+    if (enabled) {
+      registry.entries.emplace(this, socow_detail::trim_entry{&trim_reclaimable, &trim});
+    } else {
+      registry.entries.erase(this);
+    }
+    _trimmable = enabled;
+  }
+
+  bool trimmable() const noexcept {
+    return _trimmable;
+  }
+
+  // Starts making a private copy of a shared heap buffer: `executor` is called with a task that copies the
+  // elements, e.g. to run it on a thread pool. The next modification of this vector swaps the copy in, waiting
+  // for the task if it is running; if it hasn't started, it is cancelled and the copy is made as usual. If the
+  // vector got another buffer in the meantime, the copy is dropped. The task copies the elements off the calling
+  // thread, hence socow_thread_copyable; the vector and its copies still belong to the calling thread.
+  template <typename Executor>
+  requires socow_thread_copyable<value_type>::value
+  void unshare_async(Executor&& executor) {
+    if (!is_shared() || (_pending && _pending->source == _heap_buffer)) {
+      return;
+    }
+    if (_pending) {
+      discard_prepared_unique();
+    }
+    _pending = new pending_unshare(_heap_buffer, size(), capacity());
+    _heap_buffer->add_ref(size());
+    try {
+      std::forward<Executor>(executor)(unshare_task(_pending));
+    } catch (...) {
+      discard_prepared_unique();
+      throw;
+    }
+  }
+
+  // The same as unshare_async: the caller decides where the copy runs and makes sure it finishes before exit.
+  template <typename Executor>
+  requires socow_thread_copyable<value_type>::value
+  void prepare_unique(Executor&& executor) {
+    unshare_async(std::forward<Executor>(executor));
+  }
+
+  bool empty() const noexcept {
+    return !size();
+  }
+
+  size_t capacity() const noexcept {
+    return _is_small_object ? SMALL_SIZE : _heap_buffer->capacity;
+  }
+
+  void reserve(size_t new_capacity SOCOW_AND_LOCATION) {
+    SOCOW_ENTER(call_site);
+    if (new_capacity <= SMALL_SIZE) {
+      shrink_to_fit();
+    } else if (new_capacity > capacity() || (is_shared() && size() < new_capacity)) {
+      [[maybe_unused]] costly_event event(size() * sizeof(value_type));
+      size_t old_capacity = capacity();
+      bool was_small = _is_small_object;
+      assign_from(socow_vector(*this, new_capacity));
+      count_reallocation(old_capacity, was_small);
+    }
+  }
+
+  void shrink_to_fit() {
+    if (size() == capacity() || capacity() == SMALL_SIZE) {
+      return;
+    }
+    size_t old_capacity = capacity();
+    bool was_small = _is_small_object;
+    if (size() > SMALL_SIZE) {
+      assign_from(socow_vector(*this, size()));
+    } else {
+      shrink_big_to_small(size());
+    }
+    count_reallocation(old_capacity, was_small);
+  }
+
+  void clear() noexcept {
+    if (is_shared()) {
+      release_ref();
+      _is_small_object = true;
+    } else {
+      if (!_is_small_object) {
+        drop_untracked_tail();
+      }
+      destroy_last_n(size());
+    }
+    _size = 0;
+  }
+
+  iterator begin(SOCOW_LOCATION) {
+    SOCOW_ENTER(call_site);
+    return data();
+  }
+
+  iterator end(SOCOW_LOCATION) {
+    SOCOW_ENTER(call_site);
+    return data() + size();
+  }
+
+  const_iterator begin() const noexcept {
+    return data();
+  }
+
+  const_iterator end() const noexcept {
+    return data() + size();
+  }
+
+  const_iterator cbegin() const noexcept {
+    return begin();
+  }
+
+  const_iterator cend() const noexcept {
+    return end();
+  }
+
+  iterator insert(const_iterator pos, const T& value SOCOW_AND_LOCATION) {
+    SOCOW_ENTER(call_site);
+    ptrdiff_t index = pos - cbegin();
+    if (_pending) [[unlikely]] {
+      take_prepared_unique();
+    }
+    if (static_cast<size_t>(index) == size() && owns_shared_tail()) {
+      new (_heap_buffer->storage + size()) value_type(value);
+      _heap_buffer->high_water = ++_size;
+      return _heap_buffer->storage + index;
+    }
+    bool full = size() == capacity();
+    if (full || is_shared()) {
+      size_t old_capacity = capacity();
+      bool was_small = _is_small_object;
+      size_t new_capacity = empty() ? 1 : capacity() * (full ? 2 : 1);
+      [[maybe_unused]] costly_event event(size() * sizeof(value_type));
+      if (full && was_small) {
+        SOCOW_PROBE(spill, size(), new_capacity, sizeof(value_type));
+      } else if (full) {
+        SOCOW_PROBE(grow, size(), old_capacity, new_capacity, sizeof(value_type));
+      }
+      socow_vector tmp(new_capacity);
+      uninitialized_copy_bulk(cbegin(), index, tmp.begin());
+      tmp._size = index;
+      new (tmp.begin() + index) value_type(value);
+      tmp._size += 1;
+      uninitialized_copy_bulk(cbegin() + index, size() - index, tmp.begin() + index + 1);
+      tmp._size = size() + 1;
+      if (!full) {
+        count_unshare(size());
+      }
+      assign_from(tmp);
+      count_reallocation(old_capacity, was_small);
+      return _heap_buffer->storage + index;
+    } else {
+      new (data() + size()) value_type(value);
+      ++_size;
+      std::rotate(begin() + index, end() - 1, end());
+      return begin() + index;
+    }
+  }
+
+  iterator erase(const_iterator pos) {
+    return erase(pos, pos + 1);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    size_t range = last - first, index = first - cbegin();
+    if (first == last) {
+      return data() + index;
+    }
+    if (_pending) [[unlikely]] {
+      take_prepared_unique();
+    }
+    if (is_shared() && index + range == size()) {
+      _heap_buffer->track(size());
+      _size = index;
+      return _heap_buffer->storage + index;
+    }
+    if (is_shared()) {
+      [[maybe_unused]] costly_event event((size() - range) * sizeof(value_type));
+      count_unshare(size() - range);
+      if (size() - range > SMALL_SIZE) {
+        socow_vector tmp(size() - range);
+        iterator second_batch_insertion_start = std::uninitialized_copy(cbegin(), first, tmp.begin());
+        std::uninitialized_copy(last, cend(), second_batch_insertion_start);
+        tmp._size = size() - range;
+        assign_from(tmp);
+        return _heap_buffer->storage + index;
+      } else {
+        socow_vector tmp(*this, share_tag());
+        assign_from(socow_vector());
+        try {
+          iterator second_batch_start = std::uninitialized_copy(tmp.cbegin(), first, _static_buffer);
+          _size = index;
+          std::uninitialized_copy(last, tmp.cend(), second_batch_start);
+          _size = tmp.size() - range;
+        } catch (...) {
+          assign_from(tmp);
+          throw;
+        }
+        count(socow_counter::shrinks_to_small);
+        return _static_buffer + index;
+      }
+    } else {
+      if (!_is_small_object) {
+        ensure_unique();
+      }
+      for (size_t i = index; i < size() - range; ++i) {
+        std::swap(operator[](i), operator[](i + range));
+      }
+      destroy_last_n(range);
+      _size -= range;
+      return begin() + index;
+    }
+  }
+
+  // Fused algorithms. On a shared buffer the result is constructed straight into the new private buffer while the
+  // elements are copied, so each of them is read and written once, and the vector is left untouched if anything
+  // throws; an operation that turns out to change nothing keeps the buffer shared. On a unique buffer they work
+  // in place with the basic guarantee.
+
+  // Replaces every element x by f(x).
+  template <typename F>
+  void transform_inplace(F f) {
+    if (needs_private_copy()) {
+      assign_from(rebuilt(0, [&f](const_iterator first, const_iterator last, auto emit) {
+        for (; first != last; ++first) {
+          emit(f(*first));
+        }
+      }));
+    } else {
+      for (pointer p = data(), last = p + size(); p != last; ++p) {
+        *p = f(std::as_const(*p));
+      }
+    }
+  }
+
+  // Returns the number of erased elements.
+  template <typename Predicate>
+  size_t erase_if(Predicate pred) {
+    size_t index = std::find_if(cbegin(), cend(), pred) - cbegin();
+    if (index == size()) {
+      return 0;
+    }
+    size_t old_size = size();
+    if (needs_private_copy()) {
+      assign_from(rebuilt(index, [&pred](const_iterator first, const_iterator last, auto emit) {
+        while (++first != last) {
+          if (!pred(*first)) {
+            emit(*first);
+          }
+        }
+      }));
+    } else {
+      pointer first = data(), last = first + size(), out = first + index;
+      for (pointer p = out + 1; p != last; ++p) {
+        if (!pred(*p)) {
+          *out++ = std::move(*p);
+        }
+      }
+      destroy_last_n(last - out);
+      _size = out - first;
+    }
+    return old_size - size();
+  }
+
+  // Erases all but the first of every group of consecutive equal elements; returns the number of erased ones.
+  template <typename BinaryPredicate = std::equal_to<>>
+  size_t unique(BinaryPredicate pred = {}) {
+    size_t index = std::adjacent_find(cbegin(), cend(), pred) - cbegin();
+    if (index == size()) {
+      return 0;
+    }
+    size_t old_size = size();
+    if (needs_private_copy()) {
+      assign_from(rebuilt(index + 1, [&pred](const_iterator first, const_iterator last, auto emit) {
+        for (const_iterator kept = first - 1; ++first != last;) {
+          if (!pred(*kept, *first)) {
+            emit(*first);
+            kept = first;
+          }
+        }
+      }));
+    } else {
+      pointer first = data(), last = first + size(), kept = first + index;
+      for (pointer p = kept + 2; p < last; ++p) {
+        if (!pred(*kept, *p)) {
+          *++kept = std::move(*p);
+        }
+      }
+      destroy_last_n(last - kept - 1);
+      _size = kept - first + 1;
+    }
+    return old_size - size();
+  }
+
+  template <typename Predicate>
+  void replace_if(Predicate pred, const T& new_value) {
+    size_t index = std::find_if(cbegin(), cend(), pred) - cbegin();
+    if (index == size()) {
+      return;
+    }
+    if (needs_private_copy()) {
+      assign_from(rebuilt(index, [&pred, &new_value](const_iterator first, const_iterator last, auto emit) {
+        emit(new_value);
+        while (++first != last) {
+          emit(pred(*first) ? new_value : *first);
+        }
+      }));
+    } else {
+      pointer first = data();
+      first[index] = new_value;
+      std::replace_if(first + index + 1, first + size(), pred, new_value);
+    }
+  }
+
+  // Sorting needs more than one pass anyway, so a shared buffer is copied first, but the copy is sorted before
+  // it replaces the shared one, and an already sorted vector stays shared.
+  template <typename Compare = std::less<>>
+  void sort(Compare comp = {}) {
+    if (std::is_sorted(cbegin(), cend(), comp)) {
+      return;
+    }
+    if (needs_private_copy()) {
+      socow_vector tmp = rebuilt(size(), [](const_iterator, const_iterator, auto) {});
+      pointer first = tmp.data();
+      std::sort(first, first + tmp.size(), comp);
+      assign_from(tmp);
+    } else {
+      pointer first = data();
+      std::sort(first, first + size(), comp);
+    }
+  }
+
+  // A batch of edits for apply(). Every position refers to the vector as it was before any of them: insert(i, x)
+  // puts x before the element at i (or at the end for i == size()), and inserts at the same position keep their
+  // order. Erased and replaced ranges must not overlap, and an insert must not fall strictly inside an erased range.
+  class edit_plan {
+  public:
+    void insert(size_t index, const T& value) {
+      add(index, index, edit_kind::insert, value);
+    }
+
+    void erase(size_t index) {
+      erase(index, index + 1);
+    }
+
+    void erase(size_t first, size_t last) {
+      assert(first <= last);
+      if (first != last) {
+        _edits.push_back({first, last, edit_kind::erase, 0});
+      }
+    }
+
+    void replace(size_t index, const T& value) {
+      add(index, index + 1, edit_kind::replace, value);
+    }
+
+    bool empty() const noexcept {
+      return _edits.empty();
+    }
+
+    void clear() noexcept {
+      _edits.clear();
+      _values.clear();
+    }
+
+  private:
+    enum class edit_kind : uint8_t { insert, erase, replace };
+
+    struct edit {
+      size_t first;
+      size_t last;
+      edit_kind kind;
+      size_t value;
+
+      // Inserts go before an erase or a replacement at the same position.
+      bool operator<(const edit& other) const noexcept {
+        return first != other.first ? first < other.first
+                                    : (kind == edit_kind::insert) > (other.kind == edit_kind::insert);
+      }
+    };
+
+    void add(size_t first, size_t last, edit_kind kind, const T& value) {
+      _values.push_back(value);
+      try {
+        _edits.push_back({first, last, kind, _values.size() - 1});
+      } catch (...) {
+        _values.pop_back();
+        throw;
+      }
+    }
+
+    friend class socow_vector;
+
+    std::vector<edit> _edits;
+    std::vector<T> _values;
+  };
+
+  // Applies all edits in one pass over the elements, O(size() + k log k) for k edits, or O(size() + k) if they
+  // were added in order. A unique buffer with room for the result is edited in place when T moves without
+  // throwing; otherwise the result is built in a new buffer and the vector is left untouched on an exception.
+  void apply(edit_plan plan) {
+    if (plan.empty()) {
+      return;
+    }
+    auto& edits = plan._edits;
+    if (!std::is_sorted(edits.begin(), edits.end())) {
+      std::stable_sort(edits.begin(), edits.end());
+    }
+    size_t new_size = size(), read = 0;
+    for (const auto& e : edits) {
+      assert(read <= e.first && e.last <= size());
+      if (e.kind == edit_plan::edit_kind::insert) {
+        ++new_size;
+      } else {
+        new_size -= e.last - e.first - (e.kind == edit_plan::edit_kind::replace);
+        read = e.last;
+      }
+    }
+    bool shared = needs_private_copy();
+    if constexpr (std::is_nothrow_move_constructible_v<value_type> && std::is_nothrow_move_assignable_v<value_type>) {
+      if (!shared && new_size <= capacity()) {
+        apply_in_place(plan, new_size);
+        return;
+      }
+    }
+    [[maybe_unused]] costly_event event(size() * sizeof(value_type));
+    socow_vector tmp(new_size <= capacity() ? capacity() : std::max(new_size, 2 * capacity()));
+    pointer out = tmp.data();
+    const_pointer from = cbegin();
+    read = 0;
+    for (const auto& e : edits) {
+      uninitialized_copy_bulk(from + read, e.first - read, out + tmp._size);
+      tmp._size += e.first - read;
+      if (e.kind != edit_plan::edit_kind::erase) {
+        new (out + tmp._size) value_type(std::move(plan._values[e.value]));
+        ++tmp._size;
+      }
+      read = e.kind == edit_plan::edit_kind::insert ? e.first : e.last;
+    }
+    uninitialized_copy_bulk(from + read, size() - read, out + tmp._size);
+    tmp._size = new_size;
+    if (shared) {
+      count_unshare(size());
+    }
+    size_t old_capacity = capacity();
+    bool was_small = _is_small_object;
+    assign_from(tmp);
+    count_reallocation(old_capacity, was_small);
+  }
+
+  void serialize(std::ostream& out) const
+  requires std::is_trivially_copyable_v<value_type>
+  {
+    socow_file_header header = socow_detail::make_header(sizeof(value_type), size(), data());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data()), static_cast<std::streamsize>(sizeof(value_type) * size()));
+    if (!out) {
+      throw std::ios_base::failure("socow_vector: serialize");
+    }
+  }
+
+  static socow_vector deserialize(std::istream& in)
+  requires std::is_trivially_copyable_v<value_type>
+  {
+    socow_file_header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+      throw socow_format_error("socow_vector: truncated header");
+    }
+    size_t count = socow_detail::validate_header(header, sizeof(value_type));
+    // The payload of a seekable stream can be checked up front; others are read as they come.
+    size_t known = 0;
+    std::streampos offset = in.tellg();
+    if (offset != std::streampos(-1)) {
+      std::streampos end = in.seekg(0, std::ios_base::end).tellg();
+      in.clear();
+      if (in.seekg(offset) && end != std::streampos(-1)) {
+        if (static_cast<uint64_t>(std::max<std::streamoff>(end - offset, 0)) / sizeof(value_type) < count) {
+          throw socow_format_error("socow_vector: truncated payload");
+        }
+        known = count;
+      }
+    }
+    return read_payload(header, count, known, [&in](void* data, size_t bytes) {
+      if (!in.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes))) {
+        throw socow_format_error("socow_vector: truncated payload");
+      }
+    });
+  }
+
+#if SOCOW_HAS_POSIX_IO
+  void serialize(int fd) const
+  requires std::is_trivially_copyable_v<value_type>
+  {
+    socow_file_header header = socow_detail::make_header(sizeof(value_type), size(), data());
+    iovec iov[] = {
+        {&header, sizeof(header)},
+        {const_cast<value_type*>(data()), sizeof(value_type) * size()},
+    };
+    socow_detail::write_all(fd, iov, 2);
+  }
+
+  static socow_vector deserialize(int fd)
+  requires std::is_trivially_copyable_v<value_type>
+  {
+    socow_file_header header;
+    socow_detail::read_all(fd, &header, sizeof(header));
+    size_t count = socow_detail::validate_header(header, sizeof(value_type));
+    // The payload of a regular file can be checked up front; pipes and sockets are read as they come.
+    size_t known = 0;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+      off_t offset = ::lseek(fd, 0, SEEK_CUR);
+      if (offset >= 0) {
+        if (static_cast<uint64_t>(std::max<off_t>(st.st_size - offset, 0)) / sizeof(value_type) < count) {
+          throw socow_format_error("socow_vector: truncated payload");
+        }
+        known = count;
+      }
+    }
+    return read_payload(header, count, known,
+                        [fd](void* data, size_t bytes) { socow_detail::read_all(fd, data, bytes); });
+  }
+#endif
+
+#if SOCOW_HAS_MMAP
+  static socow_vector map_file(const char* path, bool verify_checksum = false)
+  requires std::is_trivially_copyable_v<value_type> && (alignof(value_type) <= sizeof(socow_file_header))
+  {
+    using mapped_buffer = external_buffer<socow_detail::file_mapping>;
+    static constexpr external_ops MAPPED_FILE_OPS = {&mapped_buffer::release, true, nullptr, nullptr};
+
+    auto* buffer = new mapped_buffer(0, nullptr, &MAPPED_FILE_OPS, socow_detail::map_serialized_file(path));
+    socow_vector result;
+    result._heap_buffer = buffer;
+    result._is_small_object = false;
+
+    const auto* bytes = static_cast<const char*>(buffer->owner.address);
+    const auto& header = *reinterpret_cast<const socow_file_header*>(bytes);
+    size_t count = socow_detail::validate_header(header, sizeof(value_type));
+    if ((buffer->owner.length - sizeof(socow_file_header)) / sizeof(value_type) < count) {
+      throw socow_format_error("socow_vector: truncated payload");
+    }
+    buffer->storage = reinterpret_cast<value_type*>(const_cast<char*>(bytes) + sizeof(socow_file_header));
+    buffer->capacity = count;
+    if (verify_checksum) {
+      socow_detail::verify_checksum(header, buffer->storage);
+    }
+    result._size = count;
+    return result;
+  }
+#endif
+
+#if SOCOW_HAS_MEMFD
+  // Writes the vector into `fd` at `offset` (a multiple of 64) and returns the offset for the next one. A segment
+  // that is still attached somewhere can't be overwritten.
+  off_t publish_shared(int fd, off_t offset = 0) const
+  requires std::is_trivially_copyable_v<value_type>
+  {
+    if (offset < 0 || offset % sizeof(socow_file_header) != 0) {
+      throw std::invalid_argument("socow_vector: segment offset must be a multiple of 64");
+    }
+    socow_file_header old;
+    if (::pread(fd, &old, sizeof(old), offset) == sizeof(old) &&
+        std::memcmp(old.magic, socow_file_header::MAGIC, sizeof(old.magic)) == 0 && old.attachments != 0) {
+      throw std::invalid_argument("socow_vector: segment is attached");
+    }
+    socow_file_header header = socow_detail::make_header(sizeof(value_type), size(), data());
+    iovec iov[] = {
+        {&header, sizeof(header)},
+        {const_cast<value_type*>(data()), sizeof(value_type) * size()},
+    };
+    socow_detail::write_all(fd, iov, 2, offset);
+    size_t end = sizeof(header) + sizeof(value_type) * size();
+    return offset + static_cast<off_t>((end + sizeof(header) - 1) / sizeof(header) * sizeof(header));
+  }
+
+  // Maps a vector published by publish_shared() in this or another process. The elements are read in place,
+  // writes copy them into private memory as with any other shared buffer.
+  static socow_vector attach_shared(int fd, off_t offset = 0)
+  requires std::is_trivially_copyable_v<value_type> && (alignof(value_type) <= sizeof(socow_file_header))
+  {
+    using shared_buffer = external_buffer<socow_detail::shared_mapping>;
+    static constexpr external_ops SHARED_SEGMENT_OPS = {&shared_buffer::release, true, nullptr, nullptr};
+
+    auto [mapping, header] = socow_detail::map_shared_segment(fd, offset, sizeof(value_type));
+    auto* storage = reinterpret_cast<value_type*>(header + 1);
+    size_t count = header->count;
+    socow_vector result;
+    result._heap_buffer = new shared_buffer(count, storage, &SHARED_SEGMENT_OPS, std::move(mapping), header);
+    result._is_small_object = false;
+    result._size = count;
+    return result;
+  }
+#endif
+
+private:
+  struct dynamic_buffer;
+
+public:
+  class buffer_deleter {
+  public:
+    void operator()(pointer) const noexcept {
+      free_buffer(_buffer);
+    }
+
+  private:
+    explicit buffer_deleter(dynamic_buffer* buffer) noexcept : _buffer(buffer) {}
+
+    friend class socow_vector;
+
+    dynamic_buffer* _buffer;
+  };
+
+  struct released_buffer {
+    pointer data;
+    size_t size;
+    size_t capacity;
+    buffer_deleter deleter;
+  };
+
+  // A vector of `size` elements that are left uninitialized, to be written through data().
+  static socow_vector for_overwrite(size_t size)
+  requires std::is_trivially_default_constructible_v<value_type>
+  {
+    socow_vector result(size);
+    result._size = size;
+    return result;
+  }
+
+  template <typename Deleter>
+  static socow_vector adopt(pointer data, size_t size, size_t capacity, Deleter deleter) {
+    assert(size <= capacity);
+    using adopted_buffer = external_buffer<adopted_storage<Deleter>>;
+    static constexpr external_ops ADOPTED_OPS = {&adopted_buffer::release, false, nullptr, nullptr};
+
+    dynamic_buffer* buffer;
+    try {
+      buffer = new adopted_buffer(capacity, data, &ADOPTED_OPS, data, std::move(deleter));
+    } catch (...) {
+      std::destroy_n(data, size);
+      deleter(data);
+      throw;
+    }
+    socow_vector result;
+    result._heap_buffer = buffer;
+    result._is_small_object = false;
+    result._size = size;
+    return result;
+  }
+
+  // The elements stay alive: the caller destroys them before passing `data` to the deleter.
+  released_buffer release() {
+    if (_is_small_object) {
+      assign_from(socow_vector(*this, SMALL_SIZE + 1));
+      count(socow_counter::spills);
+    } else {
+      ensure_unique();
+    }
+    released_buffer result{_heap_buffer->storage, size(), capacity(), buffer_deleter(_heap_buffer)};
+    _is_small_object = true;
+    _size = 0;
+    return result;
+  }
+
+private:
+  // Reads `count` elements with read(data, bytes), growing the buffer as they arrive unless `known` of them are
+  // sure to be there, so that a corrupt count fails on the missing payload instead of allocating it.
+  template <typename Read>
+  static socow_vector read_payload(const socow_file_header& header, size_t count, size_t known, Read read) {
+    constexpr size_t CHUNK = std::max<size_t>(1, (size_t(1) << 20) / sizeof(value_type));
+    socow_vector result;
+    result.reserve(known);
+    while (result.size() < count) {
+      if (result.size() == result.capacity()) {
+        result.reserve(std::min(count, std::max(2 * result.capacity(), CHUNK)));
+      }
+      size_t n = std::min(count, result.capacity()) - result.size();
+      read(result.data() + result.size(), sizeof(value_type) * n);
+      result._size += n;
+    }
+    socow_detail::verify_checksum(header, result.data());
+    return result;
+  }
+
+  // The copy constructor and the assignment without counting them in socow_stats, for the copies made inside.
+  struct share_tag {};
+
+  socow_vector(const socow_vector& other, share_tag) : socow_vector() {
+    if (other._is_small_object) {
+      assign_from(other);
+    } else {
+      _heap_buffer = other._heap_buffer;
+      _heap_buffer->add_ref(other.size());
+      _is_small_object = false;
+      _size = other.size();
+    }
+  }
+
+  socow_vector& assign_from(const socow_vector& other) {
+    if (this == &other) {
+      return *this;
+    }
+    size_t min_size = std::min(size(), other.size());
+    size_t max_size = std::max(size(), other.size());
+    if (other._is_small_object) {
+      if (_is_small_object) {
+        socow_vector tmp;
+        std::uninitialized_copy_n(other._static_buffer, min_size, tmp._static_buffer);
+        tmp._size = min_size;
+        std::uninitialized_copy(other._static_buffer + min_size, other.end(), _static_buffer + min_size);
+        _size = max_size;
+        std::swap_ranges(_static_buffer, _static_buffer + min_size, tmp._static_buffer);
+        destroy_last_n(max_size - other.size());
+      } else {
+        strong_copy_to_big_this_which_will_become_small(other._static_buffer, other.size());
+      }
+    } else {
+      assign_from(socow_vector());
+      _heap_buffer = other._heap_buffer;
+      _heap_buffer->add_ref(other.size());
+    }
+    _is_small_object = other._is_small_object;
+    _size = other.size();
+    return *this;
+  }
+
+  socow_vector(const socow_vector& other, size_t capacity) : socow_vector() {
+    _is_small_object = capacity <= SMALL_SIZE;
+    size_t size_to_copy = std::min(capacity, other.size());
+    if (!_is_small_object) {
+      if (capacity == other.capacity() && (_heap_buffer = clone_buffer(other))) {
+        socow_detail::check_no_copy("cloned", sizeof(value_type) * capacity);
+        _size = size_to_copy;
+        return;
+      }
+      _heap_buffer = allocate_buffer(capacity);
+      uninitialized_copy_bulk(other.cbegin(), size_to_copy, _heap_buffer->storage);
+    } else {
+      std::uninitialized_copy_n(other.cbegin(), size_to_copy, _static_buffer);
+    }
+    _size = size_to_copy;
+  }
+
+  // Splits the copy between the calling thread and the pool's workers once it is big enough and
+  // socow_thread_copyable allows it, see socow_config::parallel_copy_threshold. If any chunk throws, the others are destroyed and the first exception is rethrown.
+  static void uninitialized_copy_bulk(const_pointer from, size_t n, pointer to) {
+    bool streaming = use_streaming_copy(n);
+    size_t threshold = socow_config::parallel_copy_threshold.load(std::memory_order_relaxed);
+    if (!socow_thread_copyable<value_type>::value || threshold == 0 || n * sizeof(value_type) < threshold) {
+      uninitialized_copy_range(from, n, to, streaming);
+      return;
+    }
+    size_t threads = socow_config::parallel_copy_threads.load(std::memory_order_relaxed);
+    threads = std::min(threads ? threads : std::max(1u, std::thread::hardware_concurrency()), n);
+
+    struct chunk {
+      size_t first;
+      size_t last;
+      std::exception_ptr error;
+    };
+
+    std::vector<chunk> chunks(threads);
+    for (size_t i = 0; i < threads; ++i) {
+      chunks[i].first = n * i / threads;
+      chunks[i].last = n * (i + 1) / threads;
+    }
+    auto copy = [from, to, streaming, &chunks](size_t i) noexcept {
+      chunk& c = chunks[i];
+      try {
+        uninitialized_copy_range(from + c.first, c.last - c.first, to + c.first, streaming);
+      } catch (...) {
+        c.error = std::current_exception();
+      }
+    };
+    socow_detail::copy_workers().run(threads, copy);
+
+    std::exception_ptr error;
+    for (const chunk& c : chunks) {
+      if (c.error && !error) {
+        error = c.error;
+      }
+    }
+    if (error) {
+      for (const chunk& c : chunks) {
+        if (!c.error) {
+          std::destroy(to + c.first, to + c.last);
+        }
+      }
+      std::rethrow_exception(error);
+    }
+  }
+
+  static bool use_streaming_copy(size_t n) noexcept {
+    if constexpr (SOCOW_HAS_STREAMING_COPY && std::is_trivially_copyable_v<value_type>) {
+      size_t threshold = socow_config::streaming_copy_threshold.load(std::memory_order_relaxed);
+      return threshold != 0 && n * sizeof(value_type) >= threshold;
+    }
+    return false;
+  }
+
+  static void uninitialized_copy_range(const_pointer from, size_t n, pointer to, bool streaming) {
+#if SOCOW_HAS_STREAMING_COPY
+    if constexpr (std::is_trivially_copyable_v<value_type>) {
+      if (streaming) {
+        socow_detail::streaming_copy(to, from, n * sizeof(value_type));
+        return;
+      }
+    }
+#endif
+    std::uninitialized_copy_n(from, n, to);
+  }
+
+  static dynamic_buffer* allocate_buffer(size_t capacity) {
+    socow_detail::check_no_copy("allocated", sizeof(value_type) * capacity);
+#if SOCOW_HAS_MEMFD
+    if constexpr (std::is_trivially_copyable_v<value_type>) {
+      size_t threshold = socow_config::paged_cow_threshold.load(std::memory_order_relaxed);
+      if (threshold != 0 && capacity >= threshold / sizeof(value_type)) {
+        try {
+          return allocate_paged_buffer(capacity);
+        } catch (const std::system_error&) {
+        }
+      }
+    }
+#endif
+    auto* buffer = static_cast<dynamic_buffer*>(operator new(sizeof(dynamic_buffer) + sizeof(value_type) * capacity));
+    count(socow_counter::heap_bytes_allocated, sizeof(value_type) * capacity);
+    return new (buffer) dynamic_buffer(capacity);
+  }
+
+  static dynamic_buffer* clone_buffer(const socow_vector& other) {
+    if (other._is_small_object || !other._heap_buffer->external || !other._heap_buffer->external->clone) {
+      return nullptr;
+    }
+    return other._heap_buffer->external->clone(other._heap_buffer);
+  }
+
+  static bool make_writable(dynamic_buffer* buffer) noexcept {
+    return !buffer->external || !buffer->external->make_writable || buffer->external->make_writable(buffer);
+  }
+
+  void release_ref() noexcept {
+    if (_heap_buffer->ref_count == 0) {
+      SOCOW_PROBE(release, size(), _heap_buffer->capacity, sizeof(value_type));
+      if (!_heap_buffer->external) {
+        count(socow_counter::wasted_capacity_bytes,
+              sizeof(value_type) * (_heap_buffer->capacity - _heap_buffer->constructed(size())));
+      }
+      if constexpr (!std::is_trivially_destructible_v<value_type>) {
+        std::destroy_n(_heap_buffer->storage, _heap_buffer->constructed(size()));
+      }
+      free_buffer(_heap_buffer);
+    } else {
+      _heap_buffer->ref_count--;
+    }
+  }
+
+  static void free_buffer(dynamic_buffer* buffer) noexcept {
+    if (buffer->external) {
+      buffer->external->release(buffer);
+    } else {
+      count(socow_counter::heap_bytes_freed, sizeof(value_type) * buffer->capacity);
+      operator delete(buffer);
+    }
+  }
+
+  void strong_copy_to_big_this_which_will_become_small(const_iterator from, size_t n) {
+    socow_vector tmp(*this, share_tag());
+    try {
+      std::uninitialized_copy_n(from, n, _static_buffer);
+    } catch (...) {
+      _heap_buffer = tmp._heap_buffer;
+      throw;
+    }
+    tmp.release_ref();
+  }
+
+  void shrink_big_to_small(size_t new_size) {
+    SOCOW_PROBE(shrink_to_small, new_size, capacity(), sizeof(value_type));
+    strong_copy_to_big_this_which_will_become_small(this->_heap_buffer->storage, new_size);
+    _size = new_size;
+    _is_small_object = true;
+  }
+
+  void ensure_unique() {
+    assert(!_is_small_object);
+    if (_pending) [[unlikely]] {
+      take_prepared_unique();
+    }
+    if (is_shared() || !make_writable(_heap_buffer)) {
+      SOCOW_PROBE(unshare, size(), capacity(), sizeof(value_type));
+      [[maybe_unused]] costly_event event(size() * sizeof(value_type));
+      count_unshare(size());
+      assign_from(socow_vector(*this, capacity()));
+      make_writable(_heap_buffer);
+    } else if (_heap_buffer->high_water != dynamic_buffer::UNTRACKED) [[unlikely]] {
+      drop_untracked_tail();
+    }
+  }
+
+  // A buffer that was shared may hold elements appended by its former owners past this vector's size. Once this
+  // vector is its only owner they are destroyed, and the buffer stops tracking its high-water mark.
+  void drop_untracked_tail() noexcept {
+    size_t constructed = _heap_buffer->constructed(size());
+    std::destroy(_heap_buffer->storage + size(), _heap_buffer->storage + constructed);
+    _heap_buffer->high_water = dynamic_buffer::UNTRACKED;
+  }
+
+  // Whether this vector may append to its shared buffer in place: it is the one whose elements reach the
+  // high-water mark, so nobody else sees the slots past it.
+  bool owns_shared_tail() const noexcept {
+    return !_is_small_object && _heap_buffer->ref_count != 0 && _heap_buffer->high_water == size() &&
+           size() < capacity() && !(_heap_buffer->external && _heap_buffer->external->read_only) &&
+           make_writable(_heap_buffer);
+  }
+
+  // Whether a modification has to make a private copy of the buffer, as ensure_unique would.
+  bool needs_private_copy() {
+    if (_is_small_object) {
+      return false;
+    }
+    if (_pending) [[unlikely]] {
+      take_prepared_unique();
+    }
+    return is_shared() || !make_writable(_heap_buffer);
+  }
+
+  // A private buffer of the same capacity holding the first `prefix` elements, followed by what `fill` passes to
+  // `emit` while it reads the rest: fill(first, last, emit).
+  template <typename Fill>
+  socow_vector rebuilt(size_t prefix, Fill fill) const {
+    [[maybe_unused]] costly_event event(size() * sizeof(value_type));
+    count_unshare(size());
+    socow_vector tmp(capacity());
+    pointer out = tmp.data();
+    uninitialized_copy_bulk(cbegin(), prefix, out);
+    tmp._size = prefix;
+    fill(cbegin() + prefix, cend(), [&tmp, out]<typename U>(U&& value) {
+      new (out + tmp._size) value_type(std::forward<U>(value));
+      ++tmp._size;
+    });
+    return tmp;
+  }
+
+  // Erases and replaces while compacting to the left, then makes room for the inserts from the right, so that
+  // every element moves at most twice. Nothing here throws.
+  void apply_in_place(edit_plan& plan, size_t new_size) noexcept {
+    pointer p = data();
+    size_t read = 0, write = 0;
+    auto keep_until = [&](size_t index) {
+      for (; read < index; ++read, ++write) {
+        if (read != write) {
+          p[write] = std::move(p[read]);
+        }
+      }
+    };
+    for (auto& e : plan._edits) {
+      keep_until(e.first);
+      if (e.kind == edit_plan::edit_kind::insert) {
+        e.first = write;
+      } else {
+        if (e.kind == edit_plan::edit_kind::replace) {
+          p[write++] = std::move(plan._values[e.value]);
+        }
+        read = e.last;
+      }
+    }
+    keep_until(size());
+    destroy_last_n(size() - write);
+    _size = write;
+
+    size_t from = write, to = new_size;
+    auto place = [&](value_type& value) {
+      --to;
+      if (to < _size) {
+        p[to] = std::move(value);
+      } else {
+        new (p + to) value_type(std::move(value));
+      }
+    };
+    for (auto e = plan._edits.rbegin(); e != plan._edits.rend(); ++e) {
+      if (e->kind == edit_plan::edit_kind::insert) {
+        while (from > e->first) {
+          place(p[--from]);
+        }
+        place(plan._values[e->value]);
+      }
+    }
+    _size = new_size;
+  }
+
+  void destroy_last_n(size_t n) noexcept {
+    if constexpr (!std::is_trivially_destructible_v<value_type>) {
+      pointer raw_data = _is_small_object ? _static_buffer : _heap_buffer->storage;
+      for (size_t i = 1; i <= n; ++i) {
+        raw_data[size() - i].~value_type();
+      }
+    }
+  }
+
+  // Read-only external storage can't be modified in place either, so it is treated as shared.
+  bool is_shared() const noexcept {
+    return !_is_small_object && (_heap_buffer->ref_count || (_heap_buffer->external && _heap_buffer->external->read_only));
+  }
+
+  struct dynamic_buffer;
+
+  struct external_ops {
+    void (*release)(dynamic_buffer*) noexcept;
+    bool read_only;
+    // Called before the unique owner writes; returning false makes it copy the buffer instead.
+    bool (*make_writable)(dynamic_buffer*) noexcept;
+    // Produces a private copy of the whole buffer more cheaply than copying the elements, or returns nullptr.
+    dynamic_buffer* (*clone)(const dynamic_buffer*);
+  };
+
+  struct dynamic_buffer {
+    // high_water while the only owner's size is the number of constructed elements.
+    static constexpr size_t UNTRACKED = SIZE_MAX;
+
+    dynamic_buffer(size_t capacity)
+        : capacity(capacity),
+          ref_count(0),
+          high_water(UNTRACKED),
+          storage(flex),
+          external(nullptr) {
+#if SOCOW_BUFFER_REGISTRY
+      site.capture();
+#endif
+    }
+
+    dynamic_buffer(size_t capacity, value_type* storage, const external_ops* external)
+        : capacity(capacity),
+          ref_count(0),
+          high_water(UNTRACKED),
+          storage(storage),
+          external(external) {
+#if SOCOW_BUFFER_REGISTRY
+      site.capture();
+#endif
+    }
+
+    // `owner_size` is the size of the vector the new owner copies.
+    void add_ref(size_t owner_size) noexcept {
+      track(owner_size);
+      ++ref_count;
+    }
+
+    void track(size_t owner_size) noexcept {
+      if (high_water == UNTRACKED) {
+        high_water = owner_size;
+      }
+    }
+
+    size_t constructed(size_t owner_size) const noexcept {
+      return high_water == UNTRACKED ? owner_size : high_water;
+    }
+
+    size_t capacity;
+    size_t ref_count;
+    // Once shared, every owner sees a prefix of the elements, and the buffer counts how many are constructed.
+    size_t high_water;
+    value_type* storage;
+    const external_ops* external;
+#if SOCOW_BUFFER_REGISTRY
+    socow_detail::call_site site;
+#endif
+    value_type flex[0];
+  };
+
+  template <typename Owner>
+  struct external_buffer : dynamic_buffer {
+    template <typename... Args>
+    external_buffer(size_t capacity, value_type* storage, const external_ops* ops, Args&&... args)
+        : dynamic_buffer(capacity, storage, ops),
+          owner(std::forward<Args>(args)...) {}
+
+    static void release(dynamic_buffer* buffer) noexcept {
+      delete static_cast<external_buffer*>(buffer);
+    }
+
+    Owner owner;
+  };
+
+#if SOCOW_HAS_MEMFD
+  // A heap buffer living in a memfd. The unique owner of a MAP_SHARED mapping writes straight into the file;
+  // copies map the same file MAP_PRIVATE, so the kernel duplicates only the pages that get written. The file
+  // stays frozen while any private mapping of it exists.
+  struct paged_storage {
+    paged_storage(socow_detail::memfd_file* file, void* address, bool is_private) noexcept
+        : file(file),
+          address(address),
+          is_private(is_private) {}
+
+    paged_storage(const paged_storage&) = delete;
+
+    ~paged_storage() {
+      if (file->mappings == 1) {
+        count(socow_counter::heap_bytes_freed, file->length);
+      }
+      ::munmap(address, file->length);
+      file->release();
+    }
+
+    socow_detail::memfd_file* file;
+    void* address;
+    bool is_private;
+  };
+
+  using paged_buffer = external_buffer<paged_storage>;
+
+  static paged_buffer* make_paged_buffer(size_t capacity, socow_detail::memfd_file* file, void* address,
+                                         bool is_private) {
+    try {
+      return new paged_buffer(capacity, static_cast<pointer>(address), &PAGED_OPS, file, address, is_private);
+    } catch (...) {
+      ::munmap(address, file->length);
+      file->release();
+      throw;
+    }
+  }
+
+  static dynamic_buffer* allocate_paged_buffer(size_t capacity) {
+    socow_detail::memfd_file* file = socow_detail::memfd_file::create(sizeof(value_type) * capacity);
+    paged_buffer* buffer = make_paged_buffer(capacity, file, file->map(MAP_SHARED), false);
+    count(socow_counter::heap_bytes_allocated, file->length);
+    return buffer;
+  }
+
+  static bool make_paged_writable(dynamic_buffer* buffer) noexcept {
+    paged_storage& storage = static_cast<paged_buffer*>(buffer)->owner;
+    if (storage.is_private || storage.file->mappings == 1) {
+      return true;
+    }
+    if (!storage.file->remap_private(storage.address)) {
+      return false;
+    }
+    storage.is_private = true;
+    return true;
+  }
 
-  using reference = T&;
-  using const_reference = const T&;
+  // A private mapping may have written pages that exist only in its own memory, and the file under it is frozen,
+  // so it can't be mapped again: the caller copies it whole into a new memfd, which the next clone maps.
+  static dynamic_buffer* clone_paged(const dynamic_buffer* buffer) {
+    const paged_storage& storage = static_cast<const paged_buffer*>(buffer)->owner;
+    if (storage.is_private) {
+      return nullptr;
+    }
+    void* address = storage.file->map(MAP_PRIVATE);
+    return make_paged_buffer(buffer->capacity, storage.file, address, true);
+  }
 
-  using pointer = T*;
-  using const_pointer = const T*;
+  static constexpr external_ops PAGED_OPS = {&paged_buffer::release, false, &make_paged_writable, &clone_paged};
+#endif
 
-  using iterator = pointer;
-  using const_iterator = const_pointer;
+  // A copy of a shared buffer made by unshare_async. The task only reads `source` and builds `result`, copying
+  // the elements while the owning thread may be copying them too; the owning thread keeps `source` alive with an
+  // extra reference and takes or drops the result. A task that hasn't
+  // started yet is cancelled instead of waited for.
+  struct pending_unshare {
+    enum state_t { QUEUED, RUNNING, DONE, CANCELLED };
 
-public:
-  socow_vector() noexcept : _size(0), _is_small_object(true) {}
+    static constexpr size_t CHUNK = 4096;
 
-  explicit socow_vector(size_t capacity) : socow_vector(socow_vector(), capacity) {}
+    pending_unshare(dynamic_buffer* source, size_t size, size_t capacity) noexcept
+        : source(source),
+          size(size),
+          capacity(capacity) {}
 
-  socow_vector(const socow_vector& other) : socow_vector() {
-    operator=(other);
-  }
+    void run() noexcept {
+      int expected = QUEUED;
+      if (!state.compare_exchange_strong(expected, RUNNING, std::memory_order_acquire)) {
+        return;
+      }
+      dynamic_buffer* buffer = nullptr;
+      size_t copied = 0;
+      try {
+        buffer = allocate_buffer(capacity);
+        while (copied < size && !stop.load(std::memory_order_relaxed)) {
+          size_t n = std::min(CHUNK, size - copied);
+          std::uninitialized_copy_n(source->storage + copied, n, buffer->storage + copied);
+          copied += n;
+        }
+      } catch (...) {
+      }
+      if (buffer && copied < size) {
+        std::destroy_n(buffer->storage, copied);
+        free_buffer(buffer);
+        buffer = nullptr;
+      }
+      result = buffer;
+      state.store(DONE, std::memory_order_release);
+      state.notify_all();
+    }
 
-  socow_vector& operator=(const socow_vector& other) {
-    if (this == &other) {
-      return *this;
+    // Stops the task or waits for it, after which `result` is settled.
+    void finish(bool cancel) noexcept {
+      int expected = QUEUED;
+      if (state.compare_exchange_strong(expected, CANCELLED, std::memory_order_relaxed)) {
+        return;
+      }
+      if (cancel) {
+        stop.store(true, std::memory_order_relaxed);
+      }
+      state.wait(RUNNING, std::memory_order_acquire);
     }
-    size_t min_size = std::min(size(), other.size());
-    size_t max_size = std::max(size(), other.size());
-    if (other._is_small_object) {
-      if (_is_small_object) {
-        socow_vector tmp;
-        std::uninitialized_copy_n(other._static_buffer, min_size, tmp._static_buffer);
-        tmp._size = min_size;
-        std::uninitialized_copy(other._static_buffer + min_size, other.end(), _static_buffer + min_size);
-        _size = max_size;
-        std::swap_ranges(_static_buffer, _static_buffer + min_size, tmp._static_buffer);
-        destroy_last_n(max_size - other.size());
-      } else {
-        strong_copy_to_big_this_which_will_become_small(other._static_buffer, other.size());
+
+    void drop_result() noexcept {
+      if (result) {
+        std::destroy_n(result->storage, size);
+        free_buffer(result);
+        result = nullptr;
       }
-    } else {
-      operator=(socow_vector());
-      _heap_buffer = other._heap_buffer;
-      _heap_buffer->add_ref();
     }
-    _is_small_object = other._is_small_object;
-    _size = other.size();
-    return *this;
-  }
 
-  void swap(socow_vector& other) {
-    if (&other == this) {
-      return;
+    void release_source() noexcept {
+      if (source->ref_count == 0) {
+        std::destroy_n(source->storage, source->constructed(size));
+        free_buffer(source);
+      } else {
+        source->ref_count--;
+      }
     }
-    if (_is_small_object && other._is_small_object) {
-      socow_vector& bigger = size() > other.size() ? *this : other;
-      socow_vector& smaller = size() > other.size() ? other : *this;
-      std::uninitialized_copy_n(bigger._static_buffer + smaller.size(), bigger.size() - smaller.size(),
-                                smaller._static_buffer + smaller.size());
-      bigger.destroy_last_n(bigger.size() - smaller.size());
-      std::swap(bigger._is_small_object, smaller._is_small_object);
-      std::swap(bigger._size, smaller._size);
-      std::swap_ranges(bigger._static_buffer, bigger._static_buffer + smaller.size(), smaller._static_buffer);
-    } else {
-      socow_vector& static_or_dynamic_vector = _is_small_object ? *this : other;
-      socow_vector& dynamic_vector = _is_small_object ? other : *this;
-      socow_vector tmp = dynamic_vector;
-      dynamic_vector = static_or_dynamic_vector;
-      static_or_dynamic_vector = tmp;
+
+    dynamic_buffer* source;
+    size_t size;
+    size_t capacity;
+    dynamic_buffer* result = nullptr;
+    std::atomic<int> state{QUEUED};
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> owners{1};
+
+    static void release(pending_unshare* pending) noexcept {
+      if (pending->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete pending;
+      }
     }
-  }
+  };
 
-  ~socow_vector() noexcept {
-    if (_is_small_object) {
-      destroy_last_n(size());
-    } else {
-      release_ref();
-      _is_small_object = true;
+  // What the executor gets; the owning thread and every copy of the task share the state.
+  class unshare_task {
+  public:
+    explicit unshare_task(pending_unshare* pending) noexcept : pending(pending) {
+      pending->owners.fetch_add(1, std::memory_order_relaxed);
     }
-  }
 
-  reference operator[](size_t index) {
-    assert(index < size());
-    return data()[index];
-  }
+    unshare_task(const unshare_task& other) noexcept : unshare_task(other.pending) {}
 
-  const_reference operator[](size_t index) const noexcept {
-    assert(index < size());
-    return *(cbegin() + index);
-  }
+    unshare_task& operator=(const unshare_task&) = delete;
 
-  pointer data() {
-    if (_is_small_object) {
-      return _static_buffer;
-    } else {
-      ensure_unique();
-      return _heap_buffer->flex;
+    ~unshare_task() {
+      pending_unshare::release(pending);
     }
-  }
 
-  const_pointer data() const noexcept {
-    return _is_small_object ? _static_buffer : _heap_buffer->flex;
-  }
+    void operator()() const noexcept {
+      pending->run();
+    }
 
-  size_t size() const noexcept {
-    return _size;
-  }
+  private:
+    pending_unshare* pending;
+  };
 
-  reference front() {
-    assert(!empty());
-    return operator[](0);
+  static size_t trim_reclaimable(const void* vector) noexcept {
+    const auto& self = *static_cast<const socow_vector*>(vector);
+    if (self._is_small_object || self.is_shared() || self.active_growth() ||
+        (self.size() > SMALL_SIZE && 2 * self.size() > self.capacity())) {
+      return 0;
+    }
+    return (self.capacity() - (self.size() > SMALL_SIZE ? self.size() : 0)) * sizeof(value_type);
   }
 
-  const_reference front() const noexcept {
-    assert(!empty());
-    return operator[](0);
+  static void trim(void* vector) {
+    static_cast<socow_vector*>(vector)->shrink_to_fit();
   }
 
-  reference back() {
-    assert(!empty());
-    return operator[](size() - 1);
+#if SOCOW_BUFFER_REGISTRY
+  static bool describe(const void* vector, socow_detail::buffer_info& info) noexcept {
+    const auto& self = *static_cast<const socow_vector*>(vector);
+    if (self._is_small_object) {
+      return false;
+    }
+    const dynamic_buffer* buffer = self._heap_buffer;
+    info = {buffer, sizeof(value_type), buffer->capacity, buffer->ref_count + 1, buffer->constructed(self.size()),
+            buffer->external != nullptr, &buffer->site};
+    return true;
   }
+#endif
 
-  const_reference back() const noexcept {
-    assert(!empty());
-    return operator[](size() - 1);
-  }
+  // Times an unshare or a reallocation for socow_report_call_sites.
+  struct costly_event {
+#if SOCOW_CALL_SITES
+    explicit costly_event(size_t bytes) noexcept : bytes(bytes), start(std::chrono::steady_clock::now()) {}
 
-  void push_back(const T& value) {
-    insert(cend(), value);
-  }
+    costly_event(const costly_event&) = delete;
 
-  void pop_back() {
-    assert(!empty());
-    erase(cend() - 1);
-  }
+    // Allocating the first buffer of an empty vector copies nothing and isn't worth reporting.
+    ~costly_event() {
+      if (bytes != 0) {
+        socow_detail::record_costly_event(bytes, std::chrono::steady_clock::now() - start);
+      }
+    }
 
-  bool empty() const noexcept {
-    return !size();
+    size_t bytes;
+    std::chrono::steady_clock::time_point start;
+#else
+    explicit costly_event(size_t) noexcept {}
+#endif
+  };
+
+  static void count([[maybe_unused]] socow_counter counter, [[maybe_unused]] uint64_t n = 1) noexcept {
+#if SOCOW_STATS
+    socow_detail::count(counter, n);
+#endif
   }
 
-  size_t capacity() const noexcept {
-    return _is_small_object ? SMALL_SIZE : _heap_buffer->capacity;
+  static void count_unshare(size_t elements) noexcept {
+    count(socow_counter::unshares);
+    count(socow_counter::unshare_bytes, sizeof(value_type) * elements);
   }
 
-  void reserve(size_t new_capacity) {
-    if (new_capacity <= SMALL_SIZE) {
-      shrink_to_fit();
-    } else if (new_capacity > capacity() || (is_shared() && size() < new_capacity)) {
-      operator=(socow_vector(*this, new_capacity));
+  // Classifies the move of the elements to storage of another capacity.
+  void count_reallocation([[maybe_unused]] size_t old_capacity, [[maybe_unused]] bool was_small) const noexcept {
+#if SOCOW_STATS
+    if (was_small != _is_small_object) {
+      count(was_small ? socow_counter::spills : socow_counter::shrinks_to_small);
+    } else if (!was_small && old_capacity != capacity()) {
+      count(socow_counter::reallocations);
+      count(socow_counter::reallocated_from_bytes, sizeof(value_type) * old_capacity);
+      count(socow_counter::reallocated_to_bytes, sizeof(value_type) * capacity());
     }
+#endif
   }
 
-  void shrink_to_fit() {
-    if (size() == capacity() || capacity() == SMALL_SIZE) {
-      return;
-    }
-    if (size() > SMALL_SIZE) {
-      operator=(socow_vector(*this, size()));
-    } else {
-      shrink_big_to_small(size());
-    }
+  SOCOW_NOINLINE void unregister_trimmable() noexcept {
+    auto& registry = socow_detail::trimmable_vectors();
+    std::lock_guard lock(registry.mutex);
+    registry.entries.erase(this);
+    _trimmable = false;
   }
 
-  void clear() noexcept {
-    if (is_shared()) {
-      --_heap_buffer->ref_count;
-      _is_small_object = true;
-    } else {
-      destroy_last_n(size());
+  SOCOW_NOINLINE void take_prepared_unique() noexcept {
+    pending_unshare* pending = std::exchange(_pending, nullptr);
+    pending->finish(false);
+    if (pending->result && !_is_small_object && _heap_buffer == pending->source && size() == pending->size) {
+      _heap_buffer->ref_count--;
+      _heap_buffer = pending->result;
+      pending->result = nullptr;
     }
-    _size = 0;
+    pending->drop_result();
+    pending->release_source();
+    pending_unshare::release(pending);
   }
 
-  iterator begin() {
-    return data();
+  SOCOW_NOINLINE void discard_prepared_unique() noexcept {
+    pending_unshare* pending = std::exchange(_pending, nullptr);
+    pending->finish(true);
+    pending->drop_result();
+    pending->release_source();
+    pending_unshare::release(pending);
   }
 
-  iterator end() {
-    return data() + size();
-  }
+  template <typename Deleter>
+  struct adopted_storage {
+    adopted_storage(pointer data, Deleter deleter) : data(data), deleter(std::move(deleter)) {}
 
-  const_iterator begin() const noexcept {
-    return data();
-  }
+    adopted_storage(const adopted_storage&) = delete;
 
-  const_iterator end() const noexcept {
-    return data() + size();
-  }
+    ~adopted_storage() {
+      deleter(data);
+    }
 
-  const_iterator cbegin() const noexcept {
-    return begin();
-  }
+    pointer data;
+    Deleter deleter;
+  };
 
-  const_iterator cend() const noexcept {
-    return end();
-  }
+  // The buffer of an incremental growth. While the vector still fills the previous buffer `from`, the growing
+  // buffer shows the elements of `from` and push_back copies them into `elements`: [0, copied) are up to date and
+  // [0, constructed) are alive. Once `from` is full the growing buffer switches to `elements`, and push_back
+  // destroys the elements [destroyed, from_size) left in `from` before freeing it.
+  struct growth_storage {
+    growth_storage(pointer elements, size_t capacity, dynamic_buffer* from) noexcept
+        : elements(elements),
+          capacity(capacity),
+          from(from) {}
 
-  iterator insert(const_iterator pos, const T& value) {
-    ptrdiff_t index = pos - cbegin();
-    bool full = size() == capacity();
-    if (full || is_shared()) {
-      socow_vector tmp(empty() ? 1 : capacity() * (full ? 2 : 1));
-      std::uninitialized_copy_n(cbegin(), index, tmp.begin());
-      tmp._size = index;
-      new (tmp.begin() + index) value_type(value);
-      tmp._size += 1;
-      std::uninitialized_copy(cbegin() + index, cend(), tmp.begin() + index + 1);
-      tmp._size = size() + 1;
-      operator=(tmp);
-      return _heap_buffer->flex + index;
-    } else {
-      new (data() + size()) value_type(value);
-      ++_size;
-      std::rotate(begin() + index, end() - 1, end());
-      return begin() + index;
-    }
-  }
+    growth_storage(const growth_storage&) = delete;
 
-  iterator erase(const_iterator pos) {
-    return erase(pos, pos + 1);
-  }
+    ~growth_storage() {
+      if (!switched) {
+        std::destroy_n(elements, constructed);
+      } else if (from) {
+        std::destroy(from->storage + destroyed, from->storage + from_size);
+      }
+      if (from) {
+        free_buffer(from);
+      }
+      count(socow_counter::heap_bytes_freed, sizeof(value_type) * capacity);
+      operator delete(elements);
+    }
 
-  iterator erase(const_iterator first, const_iterator last) {
-    size_t range = last - first, index = first - cbegin();
-    if (first == last) {
-      return data() + index;
+    // The elements from `index` on may be written.
+    void touch(size_t index) noexcept {
+      copied = std::min(copied, index);
     }
-    if (is_shared()) {
-      if (size() - range > SMALL_SIZE) {
-        socow_vector tmp(size() - range);
-        iterator second_batch_insertion_start = std::uninitialized_copy(cbegin(), first, tmp.begin());
-        std::uninitialized_copy(last, cend(), second_batch_insertion_start);
-        tmp._size = size() - range;
-        operator=(tmp);
-        return _heap_buffer->flex + index;
-      } else {
-        socow_vector tmp = *this;
-        operator=(socow_vector());
-        try {
-          iterator second_batch_start = std::uninitialized_copy(tmp.cbegin(), first, _static_buffer);
-          _size = index;
-          std::uninitialized_copy(last, tmp.cend(), second_batch_start);
-          _size = tmp.size() - range;
-        } catch (...) {
-          operator=(tmp);
-          throw;
+
+    void copy_until(const_pointer source, size_t end) {
+      for (; copied < end; ++copied) {
+        if (copied < constructed) {
+          elements[copied] = source[copied];
+        } else {
+          new (elements + copied) value_type(source[copied]);
+          ++constructed;
         }
-        return _static_buffer + index;
-      }
-    } else {
-      for (size_t i = index; i < size() - range; ++i) {
-        std::swap(operator[](i), operator[](i + range));
       }
-      destroy_last_n(range);
-      _size -= range;
-      return begin() + index;
     }
-  }
 
-private:
-  socow_vector(const socow_vector& other, size_t capacity) : socow_vector() {
-    _is_small_object = capacity <= SMALL_SIZE;
-    size_t size_to_copy = std::min(capacity, other.size());
-    if (!_is_small_object) {
-      _heap_buffer = static_cast<dynamic_buffer*>(operator new(sizeof(dynamic_buffer) + sizeof(value_type) * capacity));
-      new (_heap_buffer) dynamic_buffer{capacity};
+    void destroy_next(size_t count) noexcept {
+      size_t end = from_size - destroyed > count ? destroyed + count : from_size;
+      std::destroy(from->storage + destroyed, from->storage + end);
+      destroyed = end;
+      if (destroyed == from_size) {
+        free_buffer(from);
+        from = nullptr;
+      }
     }
-    std::uninitialized_copy_n(other.cbegin(), size_to_copy, begin());
-    _size = size_to_copy;
+
+    pointer elements;
+    size_t capacity;
+    dynamic_buffer* from;
+    bool switched = false;
+    size_t copied = 0;
+    size_t constructed = 0;
+    size_t destroyed = 0;
+    size_t from_size = 0;
+  };
+
+  using growing_buffer = external_buffer<growth_storage>;
+
+  // Any write other than push_back, pop_back and operator[] goes through here.
+  static bool make_growth_writable(dynamic_buffer* buffer) noexcept {
+    static_cast<growing_buffer*>(buffer)->owner.touch(0);
+    return true;
   }
 
-  void release_ref() noexcept {
-    if (_heap_buffer->ref_count == 0) {
-      destroy_last_n(size());
-      operator delete(_heap_buffer);
-    } else {
-      _heap_buffer->ref_count--;
+  static constexpr external_ops GROWTH_OPS = {&growing_buffer::release, false, &make_growth_writable, nullptr};
+
+  // It is on the hot path of every vector, so the check of the flag is kept apart from the rest.
+  growth_storage* active_growth() const noexcept {
+    if (_incremental_growth) [[unlikely]] {
+      return find_growth();
     }
+    return nullptr;
   }
 
-  void strong_copy_to_big_this_which_will_become_small(const_iterator from, size_t n) {
-    socow_vector tmp = *this;
-    try {
-      std::uninitialized_copy_n(from, n, _static_buffer);
-    } catch (...) {
-      _heap_buffer = tmp._heap_buffer;
-      throw;
+  growth_storage* find_growth() const noexcept {
+    if (_is_small_object || _heap_buffer->external != &GROWTH_OPS) {
+      return nullptr;
     }
-    tmp.release_ref();
+    growth_storage* growth = &static_cast<growing_buffer*>(_heap_buffer)->owner;
+    return growth->from ? growth : nullptr;
   }
 
-  void shrink_big_to_small(size_t new_size) {
-    strong_copy_to_big_this_which_will_become_small(this->_heap_buffer->flex, new_size);
-    _size = new_size;
-    _is_small_object = true;
+  // Whether this vector may write into its growing buffer without going through ensure_unique.
+  bool owns_growth() const noexcept {
+    return !is_shared() && _heap_buffer->high_water == dynamic_buffer::UNTRACKED;
   }
 
-  void ensure_unique() {
-    assert(!_is_small_object);
-    if (_heap_buffer->ref_count) {
-      operator=(socow_vector(*this, capacity()));
+  // Drops the copy of a growth that hasn't switched yet, or destroys what is left of the previous buffer.
+  SOCOW_NOINLINE void stop_growth() noexcept {
+    growth_storage* growth = find_growth();
+    if (!growth || is_shared()) {
+      return;
+    }
+    if (growth->switched) {
+      growth->destroy_next(growth->from_size);
+    } else {
+      dynamic_buffer* from = std::exchange(growth->from, nullptr);
+      from->high_water = _heap_buffer->high_water;
+      free_buffer(_heap_buffer);
+      _heap_buffer = from;
     }
   }
 
-  void destroy_last_n(size_t n) noexcept {
-    for (size_t i = 1; i <= n; ++i) {
-      operator[](size() - i).~value_type();
+  growth_storage* start_growth() {
+    size_t new_capacity = capacity() * 2;
+    SOCOW_PROBE(grow, size(), capacity(), new_capacity, sizeof(value_type));
+    socow_detail::check_no_copy("allocated", sizeof(value_type) * new_capacity);
+    auto* elements = static_cast<pointer>(operator new(sizeof(value_type) * new_capacity));
+    growing_buffer* grown;
+    try {
+      grown = new growing_buffer(capacity(), _heap_buffer->storage, &GROWTH_OPS, elements, new_capacity, _heap_buffer);
+    } catch (...) {
+      operator delete(elements);
+      throw;
     }
+    count(socow_counter::heap_bytes_allocated, sizeof(value_type) * new_capacity);
+    _heap_buffer = grown;
+    return &grown->owner;
   }
 
-  bool is_shared() {
-    return !_is_small_object && _heap_buffer->ref_count;
+  // Called on a full buffer: copies what is left, then shows the new buffer with `value` appended.
+  void switch_growth(growth_storage* growth, const T& value) {
+    [[maybe_unused]] costly_event event((size() - growth->copied) * sizeof(value_type));
+    growth->copy_until(_heap_buffer->storage, size());
+    std::destroy(growth->elements + size(), growth->elements + growth->constructed);
+    growth->constructed = size();
+    new (growth->elements + size()) value_type(value);
+    count(socow_counter::reallocations);
+    count(socow_counter::reallocated_from_bytes, sizeof(value_type) * capacity());
+    count(socow_counter::reallocated_to_bytes, sizeof(value_type) * growth->capacity);
+    growth->switched = true;
+    growth->from_size = size();
+    _heap_buffer->storage = growth->elements;
+    _heap_buffer->capacity = growth->capacity;
+    if constexpr (std::is_trivially_destructible_v<value_type>) {
+      growth->destroy_next(growth->from_size);
+    }
   }
 
-  struct dynamic_buffer {
-    dynamic_buffer(size_t capacity) : capacity(capacity), ref_count(0) {}
-
-    void add_ref() {
-      ++ref_count;
+  // A growth starts once the buffer is so full that copying `step` elements per push_back completes the copy
+  // by the time it is full. The previous buffer has to be gone by then.
+  void push_back_growing(const T& value) {
+    if (_heap_buffer->high_water != dynamic_buffer::UNTRACKED) [[unlikely]] {
+      drop_untracked_tail();
     }
-
-    size_t capacity;
-    size_t ref_count;
-    value_type flex[0];
-  };
+    size_t step = std::max<size_t>(socow_config::incremental_growth_step.load(std::memory_order_relaxed), 1);
+    growth_storage* growth = find_growth();
+    if (growth && growth->switched) {
+      growth->destroy_next(step);
+      growth = nullptr;
+    }
+    if (!growth && (capacity() - size()) * step <= capacity()) {
+      if (growth_storage* previous = find_growth()) {
+        previous->destroy_next(previous->from_size);
+      }
+      growth = start_growth();
+    }
+    if (growth) {
+      growth->touch(size());
+      if (size() == capacity()) {
+        switch_growth(growth, value);
+        ++_size;
+        return;
+      }
+      growth->copy_until(_heap_buffer->storage, std::min(size(), growth->copied + step));
+    }
+    new (_heap_buffer->storage + size()) value_type(value);
+    ++_size;
+  }
 
   union {
     value_type _static_buffer[SMALL_SIZE];
@@ -341,6 +2898,13 @@ private:
   };
 
 private:
+  // The copy started by unshare_async, if any.
+  pending_unshare* _pending;
   size_t _size;
   bool _is_small_object;
+  bool _incremental_growth;
+  bool _trimmable;
+#if SOCOW_BUFFER_REGISTRY
+  socow_detail::registry_node _registry_node{this, &describe};
+#endif
 };
@@ -0,0 +1,177 @@
+#include "socow-algorithm.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+
+using std::as_const;
+
+namespace {
+
+class algorithm_test : public base_test {
+protected:
+  void TearDown() override {
+    socow_simd_config::max_level = socow_simd_level::avx512;
+    base_test::TearDown();
+  }
+};
+
+constexpr socow_simd_level LEVELS[] = {socow_simd_level::scalar, socow_simd_level::sse2, socow_simd_level::avx2,
+                                       socow_simd_level::avx512};
+
+constexpr size_t SIZES[] = {0, 1, 3, 15, 16, 17, 63, 64, 65, 200, 1'000, 4'099};
+
+// Small values, so that searches hit and integer sums are exact.
+template <typename T>
+socow_vector<T, 3> make_random(size_t n, uint32_t seed) {
+  std::mt19937 random(seed);
+  socow_vector<T, 3> v;
+  for (size_t i = 0; i < n; ++i) {
+    v.push_back(static_cast<T>(static_cast<int>(random() % 41) - 20));
+  }
+  return v;
+}
+
+template <typename T>
+void expect_near(T expected, T actual) {
+  if constexpr (std::is_floating_point_v<T>) {
+    EXPECT_NEAR(expected, actual, 1e-3 * std::max<T>(1, std::abs(expected)));
+  } else {
+    EXPECT_EQ(expected, actual);
+  }
+}
+
+// Compares every algorithm with its std:: counterpart at every supported instruction set.
+template <typename T>
+void check_algorithms() {
+  for (socow_simd_level level : LEVELS) {
+    socow_simd_config::max_level = level;
+    SCOPED_TRACE(static_cast<int>(level));
+    for (size_t n : SIZES) {
+      SCOPED_TRACE(n);
+      const socow_vector<T, 3> a = make_random<T>(n, static_cast<uint32_t>(n));
+      const socow_vector<T, 3> b = make_random<T>(n, static_cast<uint32_t>(n + 1));
+      const T* begin = a.data();
+      const T* end = begin + n;
+
+      for (T value : {T(-20), T(0), T(7), T(100)}) {
+        EXPECT_EQ(std::find(begin, end, value), socow_find(a, value));
+        EXPECT_EQ(static_cast<size_t>(std::count(begin, end, value)), socow_count(a, value));
+      }
+      if (n != 0) {
+        EXPECT_EQ(*std::min_element(begin, end), socow_min(a));
+        EXPECT_EQ(*std::max_element(begin, end), socow_max(a));
+      }
+      expect_near(std::accumulate(begin, end, T()), socow_sum(a));
+      expect_near(std::inner_product(begin, end, b.data(), T()), socow_dot(a, b));
+
+      const T lo = std::is_signed_v<T> ? T(-5) : T(3);
+      socow_vector<T, 3> clamped = socow_clamp(a, lo, 9);
+      socow_vector<T, 3> sum = socow_add(a, b);
+      ASSERT_EQ(n, clamped.size());
+      ASSERT_EQ(n, sum.size());
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(std::clamp(a[i], lo, T(9)), as_const(clamped)[i]);
+        ASSERT_EQ(static_cast<T>(a[i] + b[i]), as_const(sum)[i]);
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST_F(algorithm_test, int32) {
+  check_algorithms<int32_t>();
+}
+
+TEST_F(algorithm_test, int8) {
+  check_algorithms<int8_t>();
+}
+
+TEST_F(algorithm_test, int64) {
+  check_algorithms<int64_t>();
+}
+
+TEST_F(algorithm_test, uint16) {
+  check_algorithms<uint16_t>();
+}
+
+TEST_F(algorithm_test, float) {
+  check_algorithms<float>();
+}
+
+TEST_F(algorithm_test, double) {
+  check_algorithms<double>();
+}
+
+TEST_F(algorithm_test, find_first_of_many) {
+  socow_vector<int, 3> v;
+  for (int i = 0; i < 1'000; ++i) {
+    v.push_back(i % 100);
+  }
+  EXPECT_EQ(as_const(v).begin() + 42, socow_find(v, 42));
+  EXPECT_EQ(as_const(v).end(), socow_find(v, 100));
+}
+
+TEST_F(algorithm_test, count_does_not_overflow_narrow_lanes) {
+  socow_vector<int8_t, 3> v;
+  for (size_t i = 0; i < 100'000; ++i) {
+    v.push_back(1);
+  }
+  EXPECT_EQ(100'000, socow_count(v, 1));
+}
+
+// Signed overflow wraps around at every instruction set, so the scalar tail and the vector lanes agree.
+TEST_F(algorithm_test, signed_overflow_wraps) {
+  socow_vector<int32_t, 3> a;
+  socow_vector<int32_t, 3> b;
+  for (size_t i = 0; i < 1'000; ++i) {
+    a.push_back(INT32_MAX - static_cast<int32_t>(i));
+    b.push_back(INT32_MAX);
+  }
+  uint32_t sum = 0;
+  uint32_t dot = 0;
+  for (size_t i = 0; i < 1'000; ++i) {
+    sum += static_cast<uint32_t>(as_const(a)[i]);
+    dot += static_cast<uint32_t>(as_const(a)[i]) * static_cast<uint32_t>(INT32_MAX);
+  }
+  for (socow_simd_level level : LEVELS) {
+    socow_simd_config::max_level = level;
+    SCOPED_TRACE(static_cast<int>(level));
+    EXPECT_EQ(static_cast<int32_t>(sum), socow_sum(a));
+    EXPECT_EQ(static_cast<int32_t>(dot), socow_dot(a, b));
+    socow_vector<int32_t, 3> added = socow_add(a, b);
+    EXPECT_EQ(static_cast<int32_t>(static_cast<uint32_t>(INT32_MAX) * 2), as_const(added)[0]);
+  }
+}
+
+TEST_F(algorithm_test, never_unshares) {
+  socow_vector<int, 3> a = make_random<int>(1'000, 1);
+  socow_vector<int, 3> b = a;
+  socow_find(b, 7);
+  socow_count(b, 7);
+  socow_min(b);
+  socow_max(b);
+  socow_sum(b);
+  socow_dot(a, b);
+  socow_clamp(b, 0, 1);
+  socow_add(a, b);
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(algorithm_test, small_vectors) {
+  socow_vector<double, 3> v;
+  v.push_back(2.5);
+  v.push_back(-1);
+  EXPECT_EQ(-1, socow_min(v));
+  EXPECT_EQ(2.5, socow_max(v));
+  EXPECT_EQ(1.5, socow_sum(v));
+  socow_vector<double, 3> clamped = socow_clamp(v, 0, 1);
+  EXPECT_EQ(3, clamped.capacity());
+  EXPECT_EQ(1, as_const(clamped)[0]);
+  EXPECT_EQ(0, as_const(clamped)[1]);
+}
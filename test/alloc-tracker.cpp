@@ -0,0 +1,133 @@
+#include "alloc-tracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> deallocations{0};
+std::atomic<size_t> bytes_allocated{0};
+std::atomic<size_t> live_bytes{0};
+std::atomic<size_t> peak_live_bytes{0};
+
+// Every block starts with a header holding the requested size, so that deallocation can update the live size.
+size_t header_size(size_t alignment) noexcept {
+  return alignment < alignof(std::max_align_t) ? alignof(std::max_align_t) : alignment;
+}
+
+size_t& stored_size(void* p) noexcept {
+  return *(static_cast<size_t*>(p) - 1);
+}
+
+void* allocate(size_t size, size_t alignment) noexcept {
+  size_t header = header_size(alignment);
+  void* raw = alignment <= alignof(std::max_align_t)
+                ? std::malloc(header + size)
+                : std::aligned_alloc(alignment, header + (size + alignment - 1) / alignment * alignment);
+  if (!raw) {
+    return nullptr;
+  }
+  void* p = static_cast<char*>(raw) + header;
+  stored_size(p) = size;
+
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+  size_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+  while (peak < live && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+  return p;
+}
+
+void* allocate_or_throw(size_t size, size_t alignment) {
+  void* p = allocate(size, alignment);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void deallocate(void* p, size_t alignment = alignof(std::max_align_t)) noexcept {
+  if (p) {
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    live_bytes.fetch_sub(stored_size(p), std::memory_order_relaxed);
+    std::free(static_cast<char*>(p) - header_size(alignment));
+  }
+}
+
+} // namespace
+
+alloc_stats current_alloc_stats() noexcept {
+  return {allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed),
+          bytes_allocated.load(std::memory_order_relaxed), live_bytes.load(std::memory_order_relaxed),
+          peak_live_bytes.load(std::memory_order_relaxed)};
+}
+
+void reset_peak_live_bytes() noexcept {
+  peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+  return allocate_or_throw(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size) {
+  return allocate_or_throw(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size, alignof(std::max_align_t));
+}
+
+void operator delete(void* p) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+  deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  deallocate(p);
+}
+
+void operator delete(void* p, std::align_val_t alignment) noexcept {
+  deallocate(p, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept {
+  deallocate(p, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept {
+  deallocate(p, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void* p, size_t, std::align_val_t alignment) noexcept {
+  deallocate(p, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  deallocate(p);
+}
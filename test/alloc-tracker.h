@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+// Counters maintained by the replacement global operator new/delete from alloc-tracker.cpp. Bytes are the sizes
+// requested from operator new, without the allocator's own overhead.
+struct alloc_stats {
+  size_t allocations = 0;
+  size_t deallocations = 0;
+  size_t bytes_allocated = 0;
+  size_t live_bytes = 0;
+  size_t peak_live_bytes = 0;
+};
+
+alloc_stats current_alloc_stats() noexcept;
+
+// Restarts peak tracking from the current live heap size.
+void reset_peak_live_bytes() noexcept;
+
+class alloc_scope {
+public:
+  alloc_scope() noexcept {
+    reset_peak_live_bytes();
+    start = current_alloc_stats();
+  }
+
+  alloc_scope(const alloc_scope&) = delete;
+
+  alloc_stats delta() const noexcept {
+    alloc_stats now = current_alloc_stats();
+    return {now.allocations - start.allocations, now.deallocations - start.deallocations,
+            now.bytes_allocated - start.bytes_allocated, now.live_bytes - start.live_bytes,
+            now.peak_live_bytes - start.live_bytes};
+  }
+
+  // Live heap growth since the scope started, negative if the scope freed more than it allocated.
+  std::ptrdiff_t live_bytes() const noexcept {
+    return static_cast<std::ptrdiff_t>(current_alloc_stats().live_bytes - start.live_bytes);
+  }
+
+  // Highest live heap size reached within the scope, relative to its start.
+  size_t peak_bytes() const noexcept {
+    return current_alloc_stats().peak_live_bytes - start.live_bytes;
+  }
+
+private:
+  alloc_stats start;
+};
@@ -0,0 +1,312 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::as_const;
+
+namespace {
+
+// Copied by the unshare tasks, so unlike `element` it counts with atomics and opts into socow_thread_copyable.
+struct tracked {
+  tracked(size_t value) : value(value) {
+    ++instances;
+  }
+
+  tracked(const tracked& other) : value(other.value) {
+    copy();
+    ++instances;
+  }
+
+  tracked(tracked&& other) noexcept : value(other.value) {
+    ++instances;
+  }
+
+  tracked& operator=(const tracked& other) {
+    copy();
+    value = other.value;
+    return *this;
+  }
+
+  tracked& operator=(tracked&& other) noexcept {
+    value = other.value;
+    return *this;
+  }
+
+  ~tracked() {
+    --instances;
+  }
+
+  void copy() {
+    if (copy_throw_countdown != 0 && --copy_throw_countdown == 0) {
+      throw std::runtime_error("copy failed");
+    }
+    ++copies;
+  }
+
+  size_t value;
+
+  static inline std::atomic<size_t> instances = 0;
+  static inline std::atomic<size_t> copies = 0;
+  static inline std::atomic<size_t> copy_throw_countdown = 0;
+};
+
+} // namespace
+
+template <>
+struct socow_thread_copyable<tracked> : std::true_type {};
+
+namespace {
+
+using tracked_vector = socow_vector<tracked, 3>;
+
+class async_unshare_test : public base_test {
+protected:
+  void SetUp() override {
+    base_test::SetUp();
+    tracked::copies = 0;
+    tracked::copy_throw_countdown = 0;
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(0, tracked::instances);
+    base_test::TearDown();
+  }
+};
+
+// Keeps the tasks until they are run explicitly, so that the copy runs on the test thread at a chosen moment.
+struct manual_executor {
+  void operator()(std::function<void()> task) {
+    tasks.push_back(std::move(task));
+  }
+
+  void run_all() {
+    for (auto& task : tasks) {
+      task();
+    }
+    tasks.clear();
+  }
+
+  std::vector<std::function<void()>> tasks;
+};
+
+void expect_values(const tracked_vector& a, size_t n) {
+  ASSERT_EQ(n, a.size());
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(i, a[i].value);
+  }
+}
+
+template <typename Vector>
+concept async_unshareable = requires(Vector& a) { a.prepare_unique(manual_executor()); };
+
+} // namespace
+
+TEST_F(async_unshare_test, write_takes_prepared_copy) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  manual_executor executor;
+  tracked::copies = 0;
+  b.unshare_async(executor);
+  ASSERT_EQ(1, executor.tasks.size());
+  EXPECT_EQ(0, tracked::copies);
+  executor.run_all();
+  EXPECT_EQ(10, tracked::copies);
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+
+  tracked::copies = 0;
+  b[0] = 42;
+  EXPECT_EQ(0, tracked::copies);
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(a.capacity(), b.capacity());
+  EXPECT_EQ(42, as_const(b)[0].value);
+  expect_values(a, 10);
+}
+
+TEST_F(async_unshare_test, unique_does_nothing) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector small = make_vector<tracked, 3>(2);
+  manual_executor executor;
+  a.unshare_async(executor);
+  small.unshare_async(executor);
+  EXPECT_TRUE(executor.tasks.empty());
+}
+
+TEST_F(async_unshare_test, repeated_request_is_ignored) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  manual_executor executor;
+  b.unshare_async(executor);
+  b.unshare_async(executor);
+  EXPECT_EQ(1, executor.tasks.size());
+  executor.run_all();
+  b.push_back(0);
+  expect_values(a, 10);
+}
+
+TEST_F(async_unshare_test, insert_and_erase_take_prepared_copy) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  tracked_vector c = a;
+  manual_executor executor;
+  b.unshare_async(executor);
+  c.unshare_async(executor);
+  executor.run_all();
+  tracked::copies = 0;
+  b.insert(as_const(b).begin() + 5, 42);
+  c.erase(as_const(c).begin() + 2, as_const(c).begin() + 4);
+  EXPECT_EQ(1, tracked::copies);
+  EXPECT_EQ(42, as_const(b)[5].value);
+  EXPECT_EQ(11, b.size());
+  EXPECT_EQ(8, c.size());
+  EXPECT_EQ(4, as_const(c)[2].value);
+  expect_values(a, 10);
+}
+
+TEST_F(async_unshare_test, reassigned_before_copy_finished) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  tracked_vector other = make_vector<tracked, 3>(20);
+  manual_executor executor;
+  b.unshare_async(executor);
+  b = other;
+  executor.run_all();
+  b[0] = 42;
+  EXPECT_EQ(42, as_const(b)[0].value);
+  EXPECT_EQ(20, b.size());
+  expect_values(a, 10);
+  expect_values(other, 20);
+}
+
+TEST_F(async_unshare_test, shared_again_before_write) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  manual_executor executor;
+  b.unshare_async(executor);
+  executor.run_all();
+  tracked_vector c = b;
+  b[0] = 42;
+  EXPECT_EQ(42, as_const(b)[0].value);
+  expect_values(a, 10);
+  expect_values(c, 10);
+  EXPECT_EQ(as_const(a).data(), as_const(c).data());
+}
+
+TEST_F(async_unshare_test, other_owners_released) {
+  tracked_vector b = make_vector<tracked, 3>(10);
+  {
+    tracked_vector a = b;
+    manual_executor executor;
+    b.unshare_async(executor);
+    executor.run_all();
+  }
+  b[0] = 42;
+  EXPECT_EQ(42, as_const(b)[0].value);
+  EXPECT_EQ(10, b.size());
+}
+
+TEST_F(async_unshare_test, destroyed_before_copy_finished) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  manual_executor executor;
+  {
+    tracked_vector b = a;
+    b.unshare_async(executor);
+  }
+  executor.run_all();
+  expect_values(a, 10);
+}
+
+TEST_F(async_unshare_test, destroyed_last_before_copy_finished) {
+  manual_executor executor;
+  {
+    tracked_vector a = make_vector<tracked, 3>(10);
+    tracked_vector b = a;
+    b.unshare_async(executor);
+    a = tracked_vector();
+  }
+  executor.run_all();
+}
+
+TEST_F(async_unshare_test, copy_throw) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  manual_executor executor;
+  b.unshare_async(executor);
+  tracked::copy_throw_countdown = 3;
+  executor.run_all();
+  b[0] = 42;
+  EXPECT_EQ(42, as_const(b)[0].value);
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  expect_values(a, 10);
+}
+
+TEST_F(async_unshare_test, executor_throw) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  EXPECT_THROW(b.unshare_async([](auto) { throw std::runtime_error("executor"); }), std::runtime_error);
+  b[0] = 42;
+  EXPECT_EQ(42, as_const(b)[0].value);
+  expect_values(a, 10);
+}
+
+TEST_F(async_unshare_test, prepare_unique_on_thread) {
+  std::vector<std::thread> threads;
+  auto executor = [&threads](auto task) { threads.emplace_back(std::move(task)); };
+  tracked_vector a = make_vector<tracked, 3>(100'000);
+  tracked_vector b = a;
+  b.prepare_unique(executor);
+  b[0] = 42;
+  EXPECT_EQ(42, as_const(b)[0].value);
+  EXPECT_EQ(0, as_const(a)[0].value);
+  for (size_t i = 1; i < b.size(); ++i) {
+    ASSERT_EQ(as_const(a)[i].value, as_const(b)[i].value);
+  }
+
+  tracked_vector c = a;
+  c.prepare_unique(executor);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST_F(async_unshare_test, swapped_before_copy_finished) {
+  tracked_vector a = make_vector<tracked, 3>(10);
+  tracked_vector b = a;
+  tracked_vector c = make_vector<tracked, 3>(20);
+  tracked_vector d = c;
+  manual_executor executor;
+  b.unshare_async(executor);
+  b.swap(d);
+  executor.run_all();
+  b[0] = 42;
+  d[0] = 43;
+  EXPECT_EQ(20, b.size());
+  EXPECT_EQ(42, as_const(b)[0].value);
+  EXPECT_EQ(43, as_const(d)[0].value);
+  expect_values(a, 10);
+  EXPECT_EQ(0, as_const(c)[0].value);
+}
+
+TEST_F(async_unshare_test, nested_vectors) {
+  using inner = socow_vector<int, 1>;
+  static_assert(async_unshareable<socow_vector<int, 3>>);
+  static_assert(!async_unshareable<socow_vector<inner, 3>>);
+  static_assert(!async_unshareable<container>);
+  socow_vector<inner, 3> a;
+  for (int i = 0; i < 10; ++i) {
+    a.push_back(inner());
+    a.back().push_back(i);
+    a.back().push_back(i);
+  }
+  socow_vector<inner, 3> b = a;
+  b[0][0] = 42;
+  EXPECT_EQ(0, as_const(a)[0][0]);
+  EXPECT_EQ(42, as_const(b)[0][0]);
+  EXPECT_EQ(as_const(a)[1].data(), as_const(b)[1].data());
+}
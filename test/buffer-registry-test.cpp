@@ -0,0 +1,96 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+using vector = socow_vector<item, 2>;
+
+size_t count_lines(const std::string& text, const std::string& prefix) {
+  std::istringstream in(text);
+  size_t count = 0;
+  for (std::string line; std::getline(in, line);) {
+    count += line.starts_with(prefix);
+  }
+  return count;
+}
+
+} // namespace
+
+TEST(buffer_registry_test, small_vectors) {
+  vector a;
+  a.push_back(1);
+  socow_heap_summary summary = socow_summary();
+  EXPECT_EQ(0, summary.buffers);
+  EXPECT_EQ(0, summary.total_bytes);
+  EXPECT_TRUE(summary.owners_histogram.empty());
+}
+
+TEST(buffer_registry_test, unique) {
+  vector a = make_vector(5, 8);
+  socow_heap_summary summary = socow_summary();
+  EXPECT_EQ(1, summary.buffers);
+  EXPECT_EQ(8 * sizeof(item), summary.total_bytes);
+  EXPECT_EQ(0, summary.shared_bytes_saved);
+  EXPECT_EQ(3 * sizeof(item), summary.wasted_bytes);
+  EXPECT_EQ((std::map<size_t, size_t>{{1, 1}}), summary.owners_histogram);
+}
+
+TEST(buffer_registry_test, shared) {
+  vector a = make_vector(5, 8);
+  vector b = a;
+  vector c = a;
+  vector d = make_vector(10, 10);
+  socow_heap_summary summary = socow_summary();
+  EXPECT_EQ(2, summary.buffers);
+  EXPECT_EQ(18 * sizeof(item), summary.total_bytes);
+  EXPECT_EQ(10 * sizeof(item), summary.shared_bytes_saved);
+  EXPECT_EQ(3 * sizeof(item), summary.wasted_bytes);
+  EXPECT_EQ((std::map<size_t, size_t>{{1, 1}, {3, 1}}), summary.owners_histogram);
+
+  // The largest owner decides how much of the buffer is constructed.
+  b.push_back(42);
+  a.pop_back();
+  summary = socow_summary();
+  EXPECT_EQ(12 * sizeof(item), summary.shared_bytes_saved);
+  EXPECT_EQ(2 * sizeof(item), summary.wasted_bytes);
+
+  c.push_back(43);
+  summary = socow_summary();
+  EXPECT_EQ(3, summary.buffers);
+  EXPECT_EQ((std::map<size_t, size_t>{{1, 2}, {2, 1}}), summary.owners_histogram);
+}
+
+TEST(buffer_registry_test, destroyed) {
+  {
+    vector a = make_vector(5, 8);
+    vector b = a;
+    EXPECT_EQ(1, socow_summary().buffers);
+  }
+  EXPECT_EQ(0, socow_summary().buffers);
+}
+
+TEST(buffer_registry_test, dump) {
+  vector a = make_vector(5, 8);
+  vector b = a;
+  vector c = make_vector(20, 20);
+  std::ostringstream out;
+  socow_dump(out);
+  std::string text = out.str();
+  EXPECT_TRUE(text.starts_with("socow_vector heap buffers: 2,")) << text;
+  EXPECT_EQ(2, count_lines(text, "buffer "));
+  EXPECT_EQ(1, count_lines(text, "  2 owners: 1"));
+  // The largest buffer goes first.
+  size_t big = text.find("capacity 20");
+  size_t shared = text.find("owners 2");
+  ASSERT_NE(std::string::npos, big);
+  ASSERT_NE(std::string::npos, shared);
+  EXPECT_LT(big, shared);
+#if SOCOW_HAS_BACKTRACE
+  EXPECT_GT(count_lines(text, "    "), 0);
+#endif
+}
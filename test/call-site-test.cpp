@@ -0,0 +1,135 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+using vector = socow_vector<item, 2>;
+
+class call_site_test : public ::testing::Test {
+protected:
+  void SetUp() override {
+    socow_reset_call_sites();
+  }
+};
+
+const socow_call_site* find_line(const std::vector<socow_call_site>& sites, uint_least32_t line) {
+  for (const auto& site : sites) {
+    if (site.line == line && site.file == __FILE__) {
+      return &site;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST_F(call_site_test, no_events) {
+  vector a = make_vector(10, 10);
+  a[0] = 1;
+  EXPECT_TRUE(socow_top_call_sites().empty());
+}
+
+TEST_F(call_site_test, unshare_by_index) {
+  vector a = make_vector(10, 10);
+  vector b = a;
+  uint_least32_t line = __LINE__ + 1;
+  b[0] = 42;
+  b[1] = 43;
+  auto sites = socow_top_call_sites();
+  ASSERT_EQ(1, sites.size());
+  const socow_call_site* site = find_line(sites, line);
+  ASSERT_NE(nullptr, site);
+  EXPECT_EQ(1, site->events);
+  EXPECT_EQ(10 * sizeof(item), site->bytes);
+  EXPECT_NE(std::string::npos, site->function.find("unshare_by_index"));
+}
+
+TEST_F(call_site_test, unshare_by_iterator) {
+  vector a = make_vector(10, 10);
+  vector b = a;
+  uint_least32_t line = __LINE__ + 1;
+  *b.begin() = 42;
+  vector c = a;
+  uint_least32_t data_line = __LINE__ + 1;
+  c.data()[1] = 43;
+  auto sites = socow_top_call_sites();
+  EXPECT_EQ(2, sites.size());
+  EXPECT_NE(nullptr, find_line(sites, line));
+  EXPECT_NE(nullptr, find_line(sites, data_line));
+}
+
+TEST_F(call_site_test, push_back_growth) {
+  vector a = make_vector(3, 3);
+  ASSERT_EQ(3, a.capacity());
+  uint_least32_t line = __LINE__ + 2;
+  for (int i = 0; i < 10; ++i) {
+    a.push_back(i);
+  }
+  auto sites = socow_top_call_sites();
+  const socow_call_site* site = find_line(sites, line);
+  ASSERT_NE(nullptr, site);
+  // 3 -> 6 -> 12 -> 24, the growth inside push_back is not attributed to the header.
+  EXPECT_EQ(3, site->events);
+  EXPECT_EQ(21 * sizeof(item), site->bytes);
+  EXPECT_EQ(1, sites.size());
+}
+
+TEST_F(call_site_test, reserve_and_insert) {
+  vector a = make_vector(5, 5);
+  uint_least32_t reserve_line = __LINE__ + 1;
+  a.reserve(100);
+  vector b = a;
+  uint_least32_t insert_line = __LINE__ + 1;
+  b.insert(std::as_const(b).begin(), 7);
+  auto sites = socow_top_call_sites();
+  EXPECT_EQ(2, sites.size());
+  const socow_call_site* reserve_site = find_line(sites, reserve_line);
+  ASSERT_NE(nullptr, reserve_site);
+  EXPECT_EQ(5 * sizeof(item), reserve_site->bytes);
+  EXPECT_NE(nullptr, find_line(sites, insert_line));
+}
+
+TEST_F(call_site_test, other_entry_points) {
+  vector a = make_vector(10, 10);
+  vector b = a;
+  b.erase(std::as_const(b).begin());
+  auto sites = socow_top_call_sites();
+  ASSERT_EQ(1, sites.size());
+  EXPECT_TRUE(sites[0].file.empty());
+}
+
+TEST_F(call_site_test, top) {
+  vector a = make_vector(10, 10);
+  for (int i = 0; i < 3; ++i) {
+    vector b = a;
+    b[0] = i;
+  }
+  vector c = a;
+  c[1] = 1;
+  EXPECT_EQ(2, socow_top_call_sites().size());
+  ASSERT_EQ(1, socow_top_call_sites(1).size());
+  auto sites = socow_top_call_sites();
+  EXPECT_GE(sites[0].time, sites[1].time);
+}
+
+TEST_F(call_site_test, report) {
+  vector a = make_vector(10, 10);
+  vector b = a;
+  uint_least32_t line = __LINE__ + 1;
+  b[0] = 42;
+  std::ostringstream out;
+  socow_report_call_sites(out);
+  std::string text = out.str();
+  EXPECT_TRUE(text.starts_with("socow_vector unshares and reallocations by call site:\n")) << text;
+  EXPECT_NE(std::string::npos, text.find("1 events, " + std::to_string(10 * sizeof(item)) + " bytes: " +
+                                         __FILE__ + ":" + std::to_string(line) + " in "))
+      << text;
+
+  socow_reset_call_sites();
+  EXPECT_TRUE(socow_top_call_sites().empty());
+}
@@ -0,0 +1,421 @@
+#include "alloc-tracker.h"
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <type_traits>
+#include <vector>
+
+using std::as_const;
+
+namespace {
+
+constexpr size_t SMALL_SIZE = 3;
+
+struct op_cost {
+  size_t copies = 0;
+  size_t swaps = 0;
+  size_t allocations = 0;
+  size_t bytes = 0;
+};
+
+class cost_model_test : public base_test {};
+
+// The Debug build defines _GLIBCXX_DEBUG, which breaks the registry of parameterized gtest suites, so every test
+// loops over the sizes instead.
+constexpr size_t SIZES[] = {1, 3, 10, 100, 1'000, 10'000};
+
+template <typename Vector>
+Vector filled(size_t n) {
+  Vector a;
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(i + 100);
+  }
+  return a;
+}
+
+// Runs `scenario` once with elements to count copies and swaps and once with plain integers to count allocations,
+// because element allocates for its own bookkeeping. The scenario wraps the measured operation in `measured`.
+template <typename Scenario>
+op_cost measure(size_t n, Scenario scenario) {
+  op_cost cost;
+  scenario(std::type_identity<socow_vector<element, SMALL_SIZE>>(), n, [&cost](auto&& op) {
+    element::reset_counters();
+    op();
+    cost.copies = element::get_copy_counter();
+    cost.swaps = element::get_swap_counter();
+  });
+  scenario(std::type_identity<socow_vector<size_t, SMALL_SIZE>>(), n, [&cost](auto&& op) {
+    alloc_scope scope;
+    op();
+    cost.allocations = scope.delta().allocations;
+    cost.bytes = scope.delta().bytes_allocated;
+  });
+  return cost;
+}
+
+size_t max_reallocations(size_t n) {
+  return n <= SMALL_SIZE ? 0 : static_cast<size_t>(std::log2(n)) + 1;
+}
+
+#if SOCOW_HAS_MEMFD
+// Every paged buffer that isn't a mapping of another one's memfd holds a descriptor of its own.
+size_t open_files() {
+  size_t files = 0;
+  for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator("/proc/self/fd")) {
+    ++files;
+  }
+  return files;
+}
+#endif
+
+} // namespace
+
+TEST_F(cost_model_test, copy_ctor) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      measured([&] { vector b = a; });
+    });
+    EXPECT_EQ(n <= SMALL_SIZE ? n : 0, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, copy_assignment) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = filled<vector>(size);
+      measured([&] { b = a; });
+    });
+    EXPECT_GE(SMALL_SIZE, cost.copies);
+    EXPECT_GE(SMALL_SIZE, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, first_write_unshares) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      measured([&] { b.data(); });
+    });
+    bool big = n > SMALL_SIZE;
+    EXPECT_EQ(big ? n : 0, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(big ? 1 : 0, cost.allocations);
+    if (big) {
+      EXPECT_LE(n * sizeof(size_t), cost.bytes);
+      EXPECT_GE(2 * n * sizeof(size_t) + 64, cost.bytes);
+    }
+  }
+}
+
+TEST_F(cost_model_test, later_writes_are_free) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      b.data();
+      measured([&] {
+        b.data();
+        b.begin();
+        b.end();
+        b.front();
+        b.back();
+        b[size / 2];
+      });
+    });
+    EXPECT_EQ(0, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, const_access_never_copies) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      const vector b = a;
+      measured([&] {
+        b.data();
+        b.begin();
+        b.end();
+        b.front();
+        b.back();
+        b[size / 2];
+        b.size();
+        b.capacity();
+      });
+    });
+    EXPECT_EQ(0, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, push_back_is_amortized_constant) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      measured([&] { filled<vector>(size); });
+    });
+    EXPECT_GE(3 * n, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_GE(max_reallocations(n), cost.allocations);
+    EXPECT_GE(4 * n * sizeof(size_t) + 64 * cost.allocations, cost.bytes);
+  }
+}
+
+TEST_F(cost_model_test, push_back_with_spare_capacity) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      a.reserve(size + 1);
+      measured([&] { a.push_back(42); });
+    });
+    EXPECT_EQ(1, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, push_back_on_shared) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      measured([&] { b.push_back(42); });
+    });
+    // b owns the tail of the shared buffer, and filled() leaves spare capacity at every heap size here.
+    bool grows = n == SMALL_SIZE;
+    EXPECT_EQ(grows ? n + 1 : 1, cost.copies);
+    EXPECT_EQ(grows ? 1 : 0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, push_back_behind_shared_tail) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      a.push_back(7);
+      measured([&] { b.push_back(42); });
+    });
+    bool copies_all = n >= SMALL_SIZE;
+    EXPECT_EQ(copies_all ? n + 1 : 1, cost.copies);
+    EXPECT_EQ(copies_all ? 1 : 0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, pop_back_on_shared) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      measured([&] { b.pop_back(); });
+    });
+    EXPECT_EQ(0, cost.copies);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, insert_front) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      a.reserve(size + 1);
+      measured([&] { a.insert(as_const(a).begin(), 42); });
+    });
+    EXPECT_EQ(1, cost.copies);
+    EXPECT_GE(n, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, erase_front) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      measured([&] { a.erase(as_const(a).begin()); });
+    });
+    EXPECT_EQ(0, cost.copies);
+    EXPECT_EQ(n - 1, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, erase_on_shared_copies_once) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      measured([&] { b.erase(as_const(b).begin()); });
+    });
+    bool big = n > SMALL_SIZE;
+    EXPECT_EQ(big ? n - 1 : 0, cost.copies);
+    EXPECT_EQ(big ? 0 : n - 1, cost.swaps);
+    EXPECT_GE(big ? 1 : 0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, pop_back) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      measured([&] { a.pop_back(); });
+    });
+    EXPECT_EQ(0, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, reserve) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      measured([&] { a.reserve(2 * size); });
+    });
+    bool reallocates = 2 * n > SMALL_SIZE;
+    EXPECT_EQ(reallocates ? n : 0, cost.copies);
+    EXPECT_EQ(reallocates ? 1 : 0, cost.allocations);
+    if (reallocates) {
+      EXPECT_LE(2 * n * sizeof(size_t), cost.bytes);
+    }
+  }
+}
+
+TEST_F(cost_model_test, shrink_to_fit) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      a.reserve(2 * size);
+      measured([&] { a.shrink_to_fit(); });
+    });
+    bool reallocates = 2 * n > SMALL_SIZE;
+    EXPECT_EQ(reallocates ? n : 0, cost.copies);
+    EXPECT_EQ(n > SMALL_SIZE ? 1 : 0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, clear_shared) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = a;
+      measured([&] { b.clear(); });
+    });
+    EXPECT_EQ(0, cost.copies);
+    EXPECT_EQ(0, cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, swap) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    op_cost cost = measure(n, [](auto type, size_t size, auto measured) {
+      using vector = typename decltype(type)::type;
+      vector a = filled<vector>(size);
+      vector b = filled<vector>(size);
+      measured([&] { a.swap(b); });
+    });
+    EXPECT_GE(SMALL_SIZE, cost.copies + cost.swaps);
+    EXPECT_EQ(0, cost.allocations);
+  }
+}
+
+TEST_F(cost_model_test, heap_footprint) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    alloc_scope scope;
+    socow_vector<size_t, SMALL_SIZE> a = filled<socow_vector<size_t, SMALL_SIZE>>(n);
+    auto heap = static_cast<size_t>(scope.live_bytes());
+    if (n <= SMALL_SIZE) {
+      EXPECT_EQ(0, heap);
+    } else {
+      EXPECT_LE(n * sizeof(size_t), heap);
+      EXPECT_GE(2 * n * sizeof(size_t) + 64, heap);
+    }
+    // Growing by doubling never keeps more than the old and the new buffers alive.
+    EXPECT_GE(3 * heap + 128, scope.peak_bytes());
+
+    a.shrink_to_fit();
+    EXPECT_GE(n * sizeof(size_t) + 64, static_cast<size_t>(scope.live_bytes()));
+  }
+}
+
+TEST_F(cost_model_test, unshare_peak) {
+  for (size_t n : SIZES) {
+    SCOPED_TRACE(n);
+    socow_vector<size_t, SMALL_SIZE> a = filled<socow_vector<size_t, SMALL_SIZE>>(n);
+    a.shrink_to_fit();
+    socow_vector<size_t, SMALL_SIZE> b = a;
+    alloc_scope scope;
+    b.data();
+    EXPECT_EQ(scope.live_bytes(), scope.peak_bytes());
+    EXPECT_GE(n <= SMALL_SIZE ? 0 : n * sizeof(size_t) + 64, scope.peak_bytes());
+  }
+}
+
+#if SOCOW_HAS_MEMFD
+// A paged buffer that is a written private mapping can't be mapped again, so the unshare after the next
+// checkpoint copies it whole into a new memfd, which the one after that maps again. Checkpoints alternating with
+// writes cost O(pages written) and O(n) in turn.
+TEST_F(cost_model_test, paged_checkpoints) {
+  constexpr size_t N = 100'000;
+  socow_config::paged_cow_threshold = 4096;
+  {
+    socow_vector<size_t, SMALL_SIZE> state = filled<socow_vector<size_t, SMALL_SIZE>>(N);
+    std::vector<socow_vector<size_t, SMALL_SIZE>> checkpoints;
+    for (size_t k = 0; k < 6; ++k) {
+      SCOPED_TRACE(k);
+      size_t files = open_files();
+      checkpoints.push_back(state);
+      state[k] = 0;
+      EXPECT_EQ(files + k % 2, open_files());
+    }
+  }
+  socow_config::paged_cow_threshold = 0;
+}
+#endif
@@ -353,20 +353,80 @@ TEST_F(cow_test, push_back) {
 
 TEST_F(cow_test, push_back_throw) {
   container a;
-  a.reserve(6);
+  a.reserve(7);
   for (size_t i = 0; i < 5; ++i) {
     a.push_back(i + 100);
   }
+  // c takes the tail of the shared buffer, so b has to copy it.
+  container c = a;
+  c.push_back(42);
 
   for (size_t i = 1; i <= 6; ++i) {
     container b = a;
-    immutable_guard g(a, b);
+    immutable_guard g(a, b, c);
 
     element::set_copy_throw_countdown(i);
     EXPECT_THROW(b.push_back(42), std::runtime_error);
   }
 }
 
+TEST_F(cow_test, push_back_shared_tail) {
+  container a;
+  a.reserve(7);
+  for (size_t i = 0; i < 5; ++i) {
+    a.push_back(i + 100);
+  }
+  container b = a;
+  {
+    immutable_guard g(a);
+    element::reset_counters();
+    b.push_back(42);
+    b.push_back(43);
+    EXPECT_EQ(2, element::get_copy_counter());
+  }
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(7, b.size());
+  EXPECT_EQ(43, as_const(b)[6]);
+
+  // a no longer owns the tail.
+  a.push_back(44);
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(44, as_const(a)[5]);
+  EXPECT_EQ(42, as_const(b)[5]);
+}
+
+TEST_F(cow_test, push_back_shared_tail_throw) {
+  container a;
+  a.reserve(7);
+  for (size_t i = 0; i < 5; ++i) {
+    a.push_back(i + 100);
+  }
+  container b = a;
+
+  immutable_guard g(a, b);
+  element::set_copy_throw_countdown(1);
+  EXPECT_THROW(b.push_back(42), std::runtime_error);
+}
+
+TEST_F(cow_test, append_after_other_owner_is_gone) {
+  container a;
+  a.reserve(7);
+  for (size_t i = 0; i < 5; ++i) {
+    a.push_back(i + 100);
+  }
+  {
+    container b = a;
+    b.push_back(42);
+    b.push_back(43);
+  }
+  // The elements appended by b are destroyed before a writes over them.
+  const element* old_data = as_const(a).data();
+  a.push_back(44);
+  EXPECT_EQ(old_data, as_const(a).data());
+  EXPECT_EQ(6, a.size());
+  EXPECT_EQ(44, as_const(a)[5]);
+}
+
 TEST_F(cow_test, push_back_reallocation_throw) {
   container a;
   a.reserve(5);
@@ -435,7 +495,7 @@ TEST_F(cow_test, pop_back) {
   EXPECT_EQ(104, t);
 }
 
-TEST_F(cow_test, pop_back_throw) {
+TEST_F(cow_test, pop_back_shared_does_not_copy) {
   container a;
   for (size_t i = 0; i < 5; ++i) {
     a.push_back(i + 100);
@@ -443,9 +503,18 @@ TEST_F(cow_test, pop_back_throw) {
 
   container b = a;
 
-  immutable_guard g(a, b);
-  element::set_copy_throw_countdown(2);
-  EXPECT_THROW(b.pop_back(), std::runtime_error);
+  immutable_guard g(a);
+  element::set_copy_throw_countdown(1);
+  b.pop_back();
+  b.erase(as_const(b).begin() + 2, as_const(b).end());
+  EXPECT_EQ(2, b.size());
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+
+  // b no longer owns the tail, so appending copies.
+  element::set_copy_throw_countdown(0);
+  b.push_back(42);
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(42, as_const(b)[2]);
 }
 
 TEST_F(cow_test, reserve) {
@@ -0,0 +1,244 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::as_const;
+
+namespace {
+
+class edit_plan_test : public base_test {};
+
+container make_container(size_t n) {
+  container a;
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(100 + i);
+  }
+  return a;
+}
+
+template <size_t N>
+void expect_elements(const container& a, const size_t (&expected)[N]) {
+  ASSERT_EQ(N, a.size());
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_EQ(expected[i], as_const(a)[i]);
+  }
+}
+
+using string_vector = socow_vector<std::string, 3>;
+
+struct random_edit {
+  enum { insert, erase, replace } kind;
+  size_t first;
+  size_t last;
+  std::string value;
+};
+
+// Non-overlapping edits in random order, together with the expected result.
+std::vector<random_edit> make_edits(size_t n, size_t count, std::mt19937& random, std::vector<std::string>& expected) {
+  std::vector<std::vector<std::string>> inserts(n + 1);
+  std::vector<int> state(n, 0); // 0 keep, 1 erase, 2 replace
+  std::vector<std::string> replacements(n);
+  std::vector<random_edit> edits;
+  for (size_t i = 0; i < count; ++i) {
+    std::string value = "new" + std::to_string(i);
+    size_t position = random() % (n + 1);
+    switch (random() % 3) {
+    case 0:
+      inserts[position].push_back(value);
+      edits.push_back({random_edit::insert, position, position, value});
+      break;
+    case 1: {
+      size_t last = std::min(n, position + random() % 4);
+      if (std::all_of(state.begin() + position, state.begin() + last, [](int s) { return s == 0; })) {
+        std::fill(state.begin() + position, state.begin() + last, 1);
+        edits.push_back({random_edit::erase, position, last, {}});
+      }
+      break;
+    }
+    default:
+      if (position < n && state[position] == 0) {
+        state[position] = 2;
+        replacements[position] = value;
+        edits.push_back({random_edit::replace, position, position + 1, value});
+      }
+    }
+  }
+  // Inserts strictly inside an erased range are not allowed.
+  std::erase_if(edits, [&state](const random_edit& e) {
+    return e.kind == random_edit::insert && e.first != 0 && e.first < state.size() && state[e.first - 1] == 1 &&
+           state[e.first] == 1;
+  });
+  expected.clear();
+  for (size_t i = 0; i <= n; ++i) {
+    for (const random_edit& e : edits) {
+      if (e.kind == random_edit::insert && e.first == i) {
+        expected.push_back(e.value);
+      }
+    }
+    if (i < n && state[i] != 1) {
+      expected.push_back(state[i] == 2 ? replacements[i] : std::to_string(i));
+    }
+  }
+  // Shuffles everything but the inserts, which must keep their relative order.
+  auto middle = std::stable_partition(edits.begin(), edits.end(),
+                                      [](const random_edit& e) { return e.kind == random_edit::insert; });
+  std::shuffle(middle, edits.end(), random);
+  std::vector<random_edit> result;
+  for (auto i = edits.begin(), j = middle; i != middle || j != edits.end();) {
+    result.push_back(j == edits.end() || (i != middle && random() % 2) ? *i++ : *j++);
+  }
+  return result;
+}
+
+void check_random(bool shared) {
+  std::mt19937 random(shared);
+  for (size_t n : {0, 1, 2, 5, 20, 200}) {
+    for (size_t count : {1, 3, 10, 100}) {
+      SCOPED_TRACE(n);
+      SCOPED_TRACE(count);
+      string_vector a;
+      a.reserve(n + count + 1);
+      for (size_t i = 0; i < n; ++i) {
+        a.push_back(std::to_string(i));
+      }
+      string_vector b = a;
+      if (!shared) {
+        b = string_vector();
+      }
+      std::vector<std::string> expected;
+      string_vector::edit_plan plan;
+      for (const random_edit& e : make_edits(n, count, random, expected)) {
+        if (e.kind == random_edit::insert) {
+          plan.insert(e.first, e.value);
+        } else if (e.kind == random_edit::erase) {
+          plan.erase(e.first, e.last);
+        } else {
+          plan.replace(e.first, e.value);
+        }
+      }
+      const std::string* old_data = as_const(a).data();
+      a.apply(plan);
+      ASSERT_EQ(expected.size(), a.size());
+      for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], as_const(a)[i]);
+      }
+      if (shared) {
+        ASSERT_EQ(n, b.size());
+        for (size_t i = 0; i < n; ++i) {
+          ASSERT_EQ(std::to_string(i), as_const(b)[i]);
+        }
+      } else if (n + count + 1 > 3) {
+        EXPECT_EQ(old_data, as_const(a).data());
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST_F(edit_plan_test, basic) {
+  container a = make_container(6);
+  container::edit_plan plan;
+  plan.replace(4, 42);
+  plan.insert(0, 1);
+  plan.erase(1, 3);
+  plan.insert(6, 2);
+  plan.insert(3, 3);
+  plan.insert(0, 4);
+  a.apply(plan);
+  expect_elements(a, {1, 4, 100, 3, 103, 42, 105, 2});
+}
+
+TEST_F(edit_plan_test, empty_plan) {
+  container a = make_container(6);
+  container b = a;
+  a.apply(container::edit_plan());
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(edit_plan_test, insert_and_erase_at_same_position) {
+  container a = make_container(4);
+  container::edit_plan plan;
+  plan.erase(1);
+  plan.insert(1, 7);
+  plan.insert(2, 8);
+  a.apply(plan);
+  expect_elements(a, {100, 7, 8, 102, 103});
+}
+
+TEST_F(edit_plan_test, shared_copies_once) {
+  container a = make_container(10);
+  container b = a;
+  immutable_guard g(b);
+
+  container::edit_plan plan;
+  plan.erase(2, 5);
+  plan.insert(7, 42);
+  plan.replace(9, 43);
+  element::reset_counters();
+  a.apply(std::move(plan));
+  EXPECT_EQ(8, element::get_copy_counter());
+  EXPECT_EQ(0, element::get_swap_counter());
+  expect_elements(a, {100, 101, 105, 106, 42, 107, 108, 43});
+}
+
+TEST_F(edit_plan_test, throw_keeps_vector) {
+  for (bool shared : {false, true}) {
+    container a = make_container(10);
+    container b = shared ? a : container();
+
+    immutable_guard g(a, b);
+    container::edit_plan plan;
+    plan.erase(1);
+    plan.insert(5, 42);
+    plan.insert(9, 43);
+    element::set_copy_throw_countdown(6);
+    EXPECT_THROW(a.apply(std::move(plan)), std::runtime_error);
+    element::set_copy_throw_countdown(0);
+  }
+}
+
+TEST_F(edit_plan_test, grows) {
+  container a = make_container(4);
+  a.shrink_to_fit();
+  container::edit_plan plan;
+  for (size_t i = 0; i <= 4; ++i) {
+    plan.insert(i, i);
+  }
+  a.apply(plan);
+  expect_elements(a, {0, 100, 1, 101, 2, 102, 3, 103, 4});
+}
+
+TEST_F(edit_plan_test, small_object) {
+  container a = make_container(2);
+  container::edit_plan plan;
+  plan.erase(0);
+  plan.insert(2, 42);
+  a.apply(plan);
+  expect_elements(a, {101, 42});
+  expect_static_storage(a);
+}
+
+TEST_F(edit_plan_test, becomes_small) {
+  container a = make_container(10);
+  container b = a;
+  container::edit_plan plan;
+  plan.erase(0, 9);
+  a.apply(plan);
+  expect_elements(a, {109});
+}
+
+TEST_F(edit_plan_test, random_unique) {
+  check_random(false);
+}
+
+TEST_F(edit_plan_test, random_shared) {
+  check_random(true);
+}
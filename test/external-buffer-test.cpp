@@ -0,0 +1,409 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#if SOCOW_HAS_MEMFD
+#include <sys/wait.h>
+#endif
+
+using std::as_const;
+using int_vector = socow_vector<int, 3>;
+
+class external_buffer_test : public base_test {};
+
+#if SOCOW_HAS_MMAP
+namespace {
+
+class temp_file {
+public:
+  temp_file() {
+    fd = ::mkstemp(path.data());
+    EXPECT_LE(0, fd);
+  }
+
+  temp_file(const temp_file&) = delete;
+
+  ~temp_file() {
+    ::close(fd);
+    ::unlink(path.c_str());
+  }
+
+  std::string path = "/tmp/socow-vector-XXXXXX";
+  int fd;
+};
+
+int_vector make_ints(size_t n) {
+  int_vector a;
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(static_cast<int>(2 * i + 1));
+  }
+  return a;
+}
+
+} // namespace
+
+TEST_F(external_buffer_test, map_file) {
+  constexpr size_t N = 5000;
+
+  temp_file file;
+  make_ints(N).serialize(file.fd);
+
+  int_vector a = int_vector::map_file(file.path.c_str(), true);
+  ASSERT_EQ(N, a.size());
+  EXPECT_EQ(N, a.capacity());
+  for (size_t i = 0; i < N; ++i) {
+    ASSERT_EQ(2 * i + 1, as_const(a)[i]);
+  }
+}
+
+TEST_F(external_buffer_test, map_file_small) {
+  temp_file file;
+  make_ints(2).serialize(file.fd);
+
+  int_vector a = int_vector::map_file(file.path.c_str());
+  ASSERT_EQ(2, a.size());
+  EXPECT_EQ(1, as_const(a)[0]);
+  EXPECT_EQ(3, as_const(a)[1]);
+}
+
+TEST_F(external_buffer_test, map_file_copies_share_mapping) {
+  temp_file file;
+  make_ints(100).serialize(file.fd);
+
+  int_vector a = int_vector::map_file(file.path.c_str());
+  int_vector b = a;
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(external_buffer_test, map_file_first_write_unshares) {
+  constexpr size_t N = 100;
+
+  temp_file file;
+  make_ints(N).serialize(file.fd);
+
+  int_vector a = int_vector::map_file(file.path.c_str());
+  const int* mapped = as_const(a).data();
+
+  a[0] = 42;
+  EXPECT_NE(mapped, as_const(a).data());
+  EXPECT_EQ(42, as_const(a)[0]);
+  for (size_t i = 1; i < N; ++i) {
+    ASSERT_EQ(2 * i + 1, as_const(a)[i]);
+  }
+
+  int* unique = a.data();
+  a[1] = 43;
+  EXPECT_EQ(unique, a.data());
+
+  int_vector b = int_vector::map_file(file.path.c_str());
+  EXPECT_EQ(1, as_const(b)[0]);
+}
+
+TEST_F(external_buffer_test, map_file_modifications) {
+  temp_file file;
+  make_ints(10).serialize(file.fd);
+
+  int_vector a = int_vector::map_file(file.path.c_str());
+  int_vector b = a;
+  a.push_back(100);
+  b.pop_back();
+  EXPECT_EQ(11, a.size());
+  EXPECT_EQ(100, as_const(a).back());
+  EXPECT_EQ(9, b.size());
+  EXPECT_EQ(17, as_const(b).back());
+
+  int_vector c = int_vector::map_file(file.path.c_str());
+  c.erase(as_const(c).begin() + 2, as_const(c).end());
+  ASSERT_EQ(2, c.size());
+  EXPECT_EQ(3, as_const(c)[1]);
+
+  int_vector d = int_vector::map_file(file.path.c_str());
+  d.clear();
+  EXPECT_TRUE(d.empty());
+  EXPECT_EQ(3, d.capacity());
+}
+
+TEST_F(external_buffer_test, map_file_checksum) {
+  temp_file file;
+  make_ints(100).serialize(file.fd);
+  int value = -1;
+  ASSERT_EQ(sizeof(value), ::pwrite(file.fd, &value, sizeof(value), sizeof(socow_file_header) + 40));
+
+  EXPECT_NO_THROW(int_vector::map_file(file.path.c_str()));
+  EXPECT_THROW(int_vector::map_file(file.path.c_str(), true), socow_format_error);
+}
+
+TEST_F(external_buffer_test, map_file_truncated) {
+  temp_file file;
+  make_ints(100).serialize(file.fd);
+  ASSERT_EQ(0, ::ftruncate(file.fd, sizeof(socow_file_header) + 10));
+
+  EXPECT_THROW(int_vector::map_file(file.path.c_str()), socow_format_error);
+}
+
+TEST_F(external_buffer_test, map_file_missing) {
+  EXPECT_THROW(int_vector::map_file("/nonexistent/socow-vector"), std::system_error);
+}
+#endif
+
+namespace {
+
+element* allocate_elements(size_t capacity, size_t size) {
+  auto* data = static_cast<element*>(operator new(sizeof(element) * capacity));
+  for (size_t i = 0; i < size; ++i) {
+    new (data + i) element(i + 100);
+  }
+  return data;
+}
+
+} // namespace
+
+TEST_F(external_buffer_test, adopt) {
+  element* data = allocate_elements(10, 5);
+  size_t deleted = 0;
+  {
+    container a = container::adopt(data, 5, 10, [&deleted](element* p) {
+      ++deleted;
+      operator delete(p);
+    });
+    EXPECT_EQ(data, as_const(a).data());
+    EXPECT_EQ(5, a.size());
+    EXPECT_EQ(10, a.capacity());
+    for (size_t i = 0; i < 5; ++i) {
+      EXPECT_EQ(i + 100, as_const(a)[i]);
+    }
+
+    element::reset_counters();
+    a.push_back(42);
+    a[0] = 43;
+    EXPECT_EQ(data, as_const(a).data());
+    EXPECT_EQ(2, element::get_copy_counter());
+  }
+  EXPECT_EQ(1, deleted);
+}
+
+TEST_F(external_buffer_test, adopt_shared) {
+  element* data = allocate_elements(5, 5);
+  size_t deleted = 0;
+  {
+    container a = container::adopt(data, 5, 5, [&deleted](element* p) {
+      ++deleted;
+      operator delete(p);
+    });
+    {
+      container b = a;
+      EXPECT_EQ(as_const(a).data(), as_const(b).data());
+
+      b[0] = 42;
+      EXPECT_NE(as_const(a).data(), as_const(b).data());
+      EXPECT_EQ(100, as_const(a)[0]);
+      EXPECT_EQ(42, as_const(b)[0]);
+    }
+    EXPECT_EQ(0, deleted);
+
+    container c = a;
+    a.clear();
+    EXPECT_EQ(0, deleted);
+  }
+  EXPECT_EQ(1, deleted);
+}
+
+TEST_F(external_buffer_test, adopt_move_only_deleter) {
+  struct pool_handle {
+    explicit pool_handle(size_t& deleted) : deleted(std::make_unique<size_t*>(&deleted)) {}
+
+    void operator()(element* p) const {
+      ++**deleted;
+      operator delete(p);
+    }
+
+    std::unique_ptr<size_t*> deleted;
+  };
+
+  element* data = allocate_elements(4, 2);
+  size_t deleted = 0;
+  {
+    container a = container::adopt(data, 2, 4, pool_handle(deleted));
+    container b = a;
+    EXPECT_EQ(data, as_const(b).data());
+  }
+  EXPECT_EQ(1, deleted);
+}
+
+TEST_F(external_buffer_test, release_adopted) {
+  element* data = allocate_elements(8, 4);
+  size_t deleted = 0;
+  container a = container::adopt(data, 4, 8, [&deleted](element* p) {
+    ++deleted;
+    operator delete(p);
+  });
+
+  container::released_buffer released = a.release();
+  expect_empty_storage(a);
+  EXPECT_EQ(data, released.data);
+  EXPECT_EQ(4, released.size);
+  EXPECT_EQ(8, released.capacity);
+  EXPECT_EQ(103, released.data[3]);
+
+  std::destroy_n(released.data, released.size);
+  EXPECT_EQ(0, deleted);
+  released.deleter(released.data);
+  EXPECT_EQ(1, deleted);
+}
+
+TEST_F(external_buffer_test, release_shared) {
+  container a;
+  for (size_t i = 0; i < 5; ++i) {
+    a.push_back(i + 100);
+  }
+  container b = a;
+
+  container::released_buffer released = a.release();
+  expect_empty_storage(a);
+  EXPECT_NE(as_const(b).data(), released.data);
+  ASSERT_EQ(5, released.size);
+  EXPECT_LE(5, released.capacity);
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(i + 100, released.data[i]);
+    EXPECT_EQ(i + 100, as_const(b)[i]);
+  }
+
+  std::destroy_n(released.data, released.size);
+  released.deleter(released.data);
+}
+
+TEST_F(external_buffer_test, release_small) {
+  container a;
+  a.push_back(1);
+  a.push_back(2);
+
+  container::released_buffer released = a.release();
+  expect_empty_storage(a);
+  ASSERT_EQ(2, released.size);
+  EXPECT_LT(3, released.capacity);
+  EXPECT_EQ(2, released.data[1]);
+
+  std::destroy_n(released.data, released.size);
+  released.deleter(released.data);
+}
+
+TEST_F(external_buffer_test, release_unique) {
+  container a;
+  a.reserve(10);
+  a.push_back(1);
+  const element* data = as_const(a).data();
+
+  element::reset_counters();
+  container::released_buffer released = a.release();
+  EXPECT_EQ(data, released.data);
+  EXPECT_EQ(10, released.capacity);
+  EXPECT_EQ(0, element::get_copy_counter());
+
+  std::destroy_n(released.data, released.size);
+  released.deleter(released.data);
+}
+
+TEST_F(external_buffer_test, release_throw) {
+  container a;
+  for (size_t i = 0; i < 5; ++i) {
+    a.push_back(i + 100);
+  }
+  container b = a;
+  immutable_guard g(a, b);
+
+  element::set_copy_throw_countdown(3);
+  EXPECT_THROW(a.release(), std::runtime_error);
+}
+
+#if SOCOW_HAS_MEMFD
+TEST_F(external_buffer_test, shared_memory) {
+  int fd = socow_create_shared_memory();
+  int_vector a = make_ints(1000);
+  int_vector b = make_ints(2);
+  off_t b_offset = a.publish_shared(fd);
+  EXPECT_EQ(0, b_offset % sizeof(socow_file_header));
+  b.publish_shared(fd, b_offset);
+
+  {
+    int_vector sa = int_vector::attach_shared(fd);
+    int_vector sb = int_vector::attach_shared(fd, b_offset);
+    int_vector sa2 = int_vector::attach_shared(fd);
+    EXPECT_EQ(2, socow_shared_attachments(fd));
+    EXPECT_EQ(1, socow_shared_attachments(fd, b_offset));
+    EXPECT_NE(as_const(a).data(), as_const(sa).data());
+
+    ASSERT_EQ(1000, sa.size());
+    ASSERT_EQ(2, sb.size());
+    for (size_t i = 0; i < 1000; ++i) {
+      ASSERT_EQ(as_const(a)[i], as_const(sa)[i]);
+    }
+    EXPECT_EQ(3, as_const(sb)[1]);
+
+    int_vector copy = sa;
+    EXPECT_EQ(as_const(sa).data(), as_const(copy).data());
+    copy[0] = 42;
+    EXPECT_EQ(42, as_const(copy)[0]);
+    EXPECT_EQ(1, as_const(sa)[0]);
+    EXPECT_EQ(1, as_const(sa2)[0]);
+  }
+  EXPECT_EQ(0, socow_shared_attachments(fd));
+  EXPECT_EQ(0, socow_shared_attachments(fd, b_offset));
+  ::close(fd);
+}
+
+TEST_F(external_buffer_test, shared_memory_misaligned_offset) {
+  int fd = socow_create_shared_memory();
+  EXPECT_THROW(make_ints(10).publish_shared(fd, 8), std::invalid_argument);
+  EXPECT_THROW(int_vector::attach_shared(fd, 8), std::invalid_argument);
+  EXPECT_THROW(int_vector::attach_shared(fd), socow_format_error);
+  ::close(fd);
+}
+
+TEST_F(external_buffer_test, shared_memory_republish) {
+  int fd = socow_create_shared_memory();
+  make_ints(10).publish_shared(fd);
+  {
+    int_vector attached = int_vector::attach_shared(fd);
+    EXPECT_THROW(make_ints(20).publish_shared(fd), std::invalid_argument);
+    EXPECT_EQ(1, socow_shared_attachments(fd));
+    EXPECT_EQ(10, attached.size());
+  }
+  make_ints(20).publish_shared(fd);
+  EXPECT_EQ(20, int_vector::attach_shared(fd).size());
+  EXPECT_EQ(0, socow_shared_attachments(fd));
+  ::close(fd);
+}
+
+TEST_F(external_buffer_test, shared_memory_across_processes) {
+  constexpr size_t N = 100'000;
+
+  int fd = socow_create_shared_memory();
+  make_ints(N).publish_shared(fd);
+  int_vector parent = int_vector::attach_shared(fd);
+
+  pid_t pid = ::fork();
+  ASSERT_LE(0, pid);
+  if (pid == 0) {
+    int_vector child = int_vector::attach_shared(fd);
+    bool ok = socow_shared_attachments(fd) == 2 && child.size() == N;
+    for (size_t i = 0; ok && i < N; ++i) {
+      ok = as_const(child)[i] == static_cast<int>(2 * i + 1);
+    }
+    child[0] = -1;
+    ::_exit(ok && as_const(child)[0] == -1 ? 0 : 1);
+  }
+
+  int status = 0;
+  ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_EQ(1, as_const(parent)[0]);
+  EXPECT_EQ(1, socow_shared_attachments(fd));
+  ::close(fd);
+}
+#endif
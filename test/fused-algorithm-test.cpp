@@ -0,0 +1,234 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+using std::as_const;
+
+namespace {
+
+class fused_algorithm_test : public base_test {};
+
+container make_container(std::initializer_list<size_t> values) {
+  container a;
+  for (size_t value : values) {
+    a.push_back(value);
+  }
+  return a;
+}
+
+template <size_t N>
+void expect_elements(const container& a, const size_t (&expected)[N]) {
+  ASSERT_EQ(N, a.size());
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_EQ(expected[i], as_const(a)[i]);
+  }
+}
+
+auto is_any_of(size_t x, size_t y) {
+  return [x, y](const element& e) { return e == x || e == y; };
+}
+
+} // namespace
+
+TEST_F(fused_algorithm_test, erase_if_shared) {
+  container a = make_container({100, 101, 102, 103, 104, 105, 106, 107, 108, 109});
+  container b = a;
+  immutable_guard g(b);
+
+  element::reset_counters();
+  EXPECT_EQ(2, a.erase_if(is_any_of(102, 105)));
+  EXPECT_EQ(8, element::get_copy_counter());
+  EXPECT_EQ(0, element::get_swap_counter());
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  expect_elements(a, {100, 101, 103, 104, 106, 107, 108, 109});
+}
+
+TEST_F(fused_algorithm_test, erase_if_unique) {
+  container a = make_container({100, 101, 102, 103, 104, 105, 106});
+  const element* old_data = as_const(a).data();
+  EXPECT_EQ(2, a.erase_if(is_any_of(100, 105)));
+  EXPECT_EQ(old_data, as_const(a).data());
+  expect_elements(a, {101, 102, 103, 104, 106});
+}
+
+TEST_F(fused_algorithm_test, erase_if_small) {
+  container a = make_container({100, 101, 102});
+  EXPECT_EQ(1, a.erase_if(is_any_of(101, 101)));
+  expect_elements(a, {100, 102});
+  expect_static_storage(a);
+}
+
+TEST_F(fused_algorithm_test, erase_if_nothing_stays_shared) {
+  container a = make_container({100, 101, 102, 103, 104});
+  container b = a;
+
+  element::reset_counters();
+  EXPECT_EQ(0, a.erase_if(is_any_of(42, 43)));
+  EXPECT_EQ(0, element::get_copy_counter());
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(fused_algorithm_test, erase_if_throw) {
+  container a = make_container({100, 101, 102, 103, 104, 105});
+  container b = a;
+
+  immutable_guard g(a, b);
+  element::set_copy_throw_countdown(3);
+  EXPECT_THROW(a.erase_if(is_any_of(101, 101)), std::runtime_error);
+}
+
+TEST_F(fused_algorithm_test, replace_if_shared) {
+  container a = make_container({100, 101, 102, 103, 104, 105});
+  container b = a;
+  immutable_guard g(b);
+
+  element::reset_counters();
+  a.replace_if(is_any_of(101, 104), 42);
+  EXPECT_EQ(6, element::get_copy_counter());
+  expect_elements(a, {100, 42, 102, 103, 42, 105});
+}
+
+TEST_F(fused_algorithm_test, replace_if_unique) {
+  container a = make_container({100, 101, 102, 103, 104, 105});
+  const element* old_data = as_const(a).data();
+  a.replace_if(is_any_of(101, 104), 42);
+  EXPECT_EQ(old_data, as_const(a).data());
+  expect_elements(a, {100, 42, 102, 103, 42, 105});
+}
+
+TEST_F(fused_algorithm_test, replace_if_throw) {
+  container a = make_container({100, 101, 102, 103, 104, 105});
+  container b = a;
+
+  immutable_guard g(a, b);
+  element::set_copy_throw_countdown(4);
+  EXPECT_THROW(a.replace_if(is_any_of(100, 102), 42), std::runtime_error);
+}
+
+TEST_F(fused_algorithm_test, unique_shared) {
+  container a = make_container({1, 1, 2, 2, 2, 3, 1, 1, 4});
+  container b = a;
+  immutable_guard g(b);
+
+  element::reset_counters();
+  EXPECT_EQ(4, a.unique());
+  EXPECT_EQ(5, element::get_copy_counter());
+  expect_elements(a, {1, 2, 3, 1, 4});
+}
+
+TEST_F(fused_algorithm_test, unique_unique) {
+  container a = make_container({1, 2, 2, 2, 3, 3, 1, 4, 4});
+  const element* old_data = as_const(a).data();
+  EXPECT_EQ(4, a.unique());
+  EXPECT_EQ(old_data, as_const(a).data());
+  expect_elements(a, {1, 2, 3, 1, 4});
+}
+
+TEST_F(fused_algorithm_test, unique_nothing_stays_shared) {
+  container a = make_container({1, 2, 3, 1, 2});
+  container b = a;
+  EXPECT_EQ(0, a.unique());
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(fused_algorithm_test, unique_predicate) {
+  socow_vector<int, 3> a;
+  for (int x : {1, 3, 5, 2, 4, 7, 8}) {
+    a.push_back(x);
+  }
+  socow_vector<int, 3> b = a;
+  EXPECT_EQ(3, a.unique([](int x, int y) { return x % 2 == y % 2; }));
+  ASSERT_EQ(4, a.size());
+  EXPECT_EQ(1, as_const(a)[0]);
+  EXPECT_EQ(2, as_const(a)[1]);
+  EXPECT_EQ(7, as_const(a)[2]);
+  EXPECT_EQ(8, as_const(a)[3]);
+  EXPECT_EQ(7, b.size());
+}
+
+TEST_F(fused_algorithm_test, transform_inplace) {
+  socow_vector<std::string, 3> a;
+  for (int i = 0; i < 10; ++i) {
+    a.push_back(std::to_string(i));
+  }
+  socow_vector<std::string, 3> b = a;
+  a.transform_inplace([](const std::string& s) { return s + "!"; });
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(std::to_string(i) + "!", as_const(a)[i]);
+    EXPECT_EQ(std::to_string(i), as_const(b)[i]);
+  }
+
+  const std::string* old_data = as_const(a).data();
+  a.transform_inplace([](const std::string& s) { return s + "?"; });
+  EXPECT_EQ(old_data, as_const(a).data());
+  EXPECT_EQ("9!?", as_const(a)[9]);
+}
+
+TEST_F(fused_algorithm_test, transform_inplace_throw) {
+  container a = make_container({100, 101, 102, 103, 104, 105});
+  container b = a;
+
+  immutable_guard g(a, b);
+  EXPECT_THROW(a.transform_inplace([](const element& e) -> element {
+    if (e == 103) {
+      throw std::runtime_error("transform failed");
+    }
+    return 42;
+  }),
+               std::runtime_error);
+}
+
+TEST_F(fused_algorithm_test, sort) {
+  socow_vector<int, 3> a;
+  for (int x : {5, 3, 9, 1, 7, 2}) {
+    a.push_back(x);
+  }
+  socow_vector<int, 3> b = a;
+  a.sort();
+  const int sorted[] = {1, 2, 3, 5, 7, 9};
+  const int original[] = {5, 3, 9, 1, 7, 2};
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_EQ(sorted[i], as_const(a)[i]);
+    EXPECT_EQ(original[i], as_const(b)[i]);
+  }
+
+  const int* old_data = as_const(a).data();
+  a.sort(std::greater<>());
+  EXPECT_EQ(old_data, as_const(a).data());
+  EXPECT_EQ(9, as_const(a)[0]);
+  EXPECT_EQ(1, as_const(a)[5]);
+}
+
+TEST_F(fused_algorithm_test, sort_sorted_stays_shared) {
+  socow_vector<int, 3> a;
+  for (int i = 0; i < 10; ++i) {
+    a.push_back(i);
+  }
+  socow_vector<int, 3> b = a;
+  a.sort();
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(fused_algorithm_test, sort_throw) {
+  socow_vector<int, 3> a;
+  for (int x : {5, 3, 9, 1, 7, 2}) {
+    a.push_back(x);
+  }
+  socow_vector<int, 3> b = a;
+  size_t calls = 0;
+  EXPECT_THROW(a.sort([&calls](int x, int y) {
+    if (++calls == 10) {
+      throw std::runtime_error("compare failed");
+    }
+    return x < y;
+  }),
+               std::runtime_error);
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(5, as_const(a)[0]);
+  EXPECT_EQ(2, as_const(a)[5]);
+}
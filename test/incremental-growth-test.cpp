@@ -0,0 +1,362 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <string>
+#include <thread>
+
+using std::as_const;
+
+namespace {
+
+using string_vector = socow_vector<std::string, 3>;
+
+class incremental_growth_test : public base_test {
+protected:
+  void SetUp() override {
+    base_test::SetUp();
+    socow_config::incremental_growth_step = 4;
+  }
+
+  void TearDown() override {
+    socow_config::incremental_growth_step = 32;
+    base_test::TearDown();
+  }
+};
+
+std::string value(size_t i) {
+  return "incremental-growth-value-" + std::to_string(i);
+}
+
+string_vector make_growing(size_t n) {
+  string_vector a;
+  a.set_incremental_growth(true);
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(value(i));
+  }
+  return a;
+}
+
+void expect_values(const string_vector& a, size_t n) {
+  ASSERT_EQ(n, a.size());
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(value(i), a[i]);
+  }
+}
+
+// Counts copies and moves so that the work done by a single push_back can be checked.
+struct counted {
+  counted(size_t value) : value(value) {}
+
+  counted(const counted& other) : value(other.value) {
+    if (throw_on_copy) {
+      throw std::runtime_error("copy");
+    }
+    ++copies;
+  }
+
+  counted(counted&& other) noexcept : value(other.value) {
+    ++moves;
+  }
+
+  counted& operator=(const counted& other) {
+    value = other.value;
+    ++copies;
+    return *this;
+  }
+
+  size_t value;
+
+  static inline size_t copies = 0;
+  static inline size_t moves = 0;
+  static inline bool throw_on_copy = false;
+};
+
+using counted_vector = socow_vector<counted, 3>;
+
+// Pushes until a growth is copying elements, but hasn't switched yet.
+void grow_until_copying(counted_vector& a, size_t capacity) {
+  a.set_incremental_growth(true);
+  while (a.capacity() < capacity || a.size() < capacity - capacity / 8) {
+    a.push_back(a.size());
+  }
+}
+
+} // namespace
+
+TEST_F(incremental_growth_test, push_back) {
+  string_vector a = make_growing(1000);
+  EXPECT_TRUE(a.incremental_growth());
+  EXPECT_EQ(1536, a.capacity());
+  expect_values(a, 1000);
+  expect_values(as_const(a), 1000);
+}
+
+TEST_F(incremental_growth_test, reads_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  const string_vector& ref = a;
+  for (size_t i = 0; i <= 96; ++i) {
+    EXPECT_EQ(value(i), ref[i]);
+    EXPECT_EQ(value(i), a[i]);
+  }
+  EXPECT_EQ(value(0), a.front());
+  EXPECT_EQ(value(96), a.back());
+  EXPECT_EQ(192, a.capacity());
+}
+
+TEST_F(incremental_growth_test, writes_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  a[0] = "first";
+  a[40] = "middle";
+  a.back() = "last";
+  a.push_back(value(97));
+  EXPECT_EQ("first", a[0]);
+  EXPECT_EQ("middle", a[40]);
+  EXPECT_EQ("last", a[96]);
+  EXPECT_EQ(value(97), a[97]);
+  EXPECT_EQ("middle", a.data()[40]);
+}
+
+TEST_F(incremental_growth_test, bounded_copies_per_push_back) {
+  counted_vector a;
+  a.set_incremental_growth(true);
+  size_t max_copies = 0;
+  for (size_t i = 0; i < 10'000; ++i) {
+    counted::copies = 0;
+    counted::moves = 0;
+    a.push_back(i);
+    max_copies = std::max(max_copies, counted::copies);
+    ASSERT_EQ(0, counted::moves);
+  }
+  // The pushed element and 4 copied ones.
+  EXPECT_GE(5, max_copies);
+  for (size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(i, a[i].value);
+  }
+}
+
+TEST_F(incremental_growth_test, const_reads_change_nothing) {
+  counted_vector a;
+  grow_until_copying(a, 1536);
+  const counted_vector& ref = a;
+  const counted* data = ref.data();
+  counted::copies = 0;
+  counted::moves = 0;
+  size_t sum = 0;
+  for (const counted& x : ref) {
+    sum += x.value;
+  }
+  EXPECT_EQ(ref.size() * (ref.size() - 1) / 2, sum);
+  EXPECT_EQ(ref.size() - 1, ref.back().value);
+  EXPECT_EQ(data, ref.data());
+  EXPECT_EQ(0, counted::copies);
+  EXPECT_EQ(0, counted::moves);
+}
+
+TEST_F(incremental_growth_test, concurrent_const_reads) {
+  counted_vector a;
+  for (size_t capacity : {1536, 3072}) {
+    grow_until_copying(a, capacity);
+    for (size_t switched = 0; switched < 2; ++switched) {
+      const counted_vector& ref = a;
+      size_t expected = ref.size() * (ref.size() - 1) / 2;
+      auto read = [&ref] {
+        size_t sum = 0;
+        for (const counted* p = ref.data(); p != ref.data() + ref.size(); ++p) {
+          sum += p->value;
+        }
+        for (size_t i = 0; i < ref.size(); ++i) {
+          sum -= ref[i].value;
+        }
+        return sum + std::accumulate(ref.begin(), ref.end(), size_t(0),
+                                     [](size_t acc, const counted& x) { return acc + x.value; });
+      };
+      size_t other = 0;
+      std::thread reader([&] { other = read(); });
+      EXPECT_EQ(expected, read());
+      reader.join();
+      EXPECT_EQ(expected, other);
+      while (a.size() < a.capacity()) {
+        a.push_back(a.size());
+      }
+      a.push_back(a.size());
+    }
+  }
+}
+
+// Non-const begin() and end() restart the copy, so the push_back that fills the buffer copies all of it, while
+// const iteration leaves every push_back bounded.
+TEST_F(incremental_growth_test, iteration_during_growth) {
+  for (bool writable : {false, true}) {
+    SCOPED_TRACE(writable);
+    counted_vector a;
+    grow_until_copying(a, 1536);
+    size_t max_copies = 0;
+    while (a.capacity() == 1536) {
+      size_t sum = 0;
+      if (writable) {
+        for (counted& x : a) {
+          sum += x.value;
+        }
+      } else {
+        for (const counted& x : as_const(a)) {
+          sum += x.value;
+        }
+      }
+      ASSERT_EQ(a.size() * (a.size() - 1) / 2, sum);
+      counted::copies = 0;
+      a.push_back(a.size());
+      max_copies = std::max(max_copies, counted::copies);
+    }
+    if (writable) {
+      EXPECT_LT(1536, max_copies);
+    } else {
+      EXPECT_GE(5, max_copies);
+    }
+  }
+}
+
+TEST_F(incremental_growth_test, writes_before_switch) {
+  counted_vector a;
+  grow_until_copying(a, 1536);
+  size_t size = a.size();
+  a[0] = 1'000'000;
+  a.front().value += 1;
+  a.back() = 2'000'000;
+  a.data()[1] = 3'000'000;
+  a.erase(as_const(a).begin() + 2);
+  a.insert(as_const(a).begin() + 2, 2);
+  a.pop_back();
+  a.push_back(size - 1);
+  while (a.size() <= 1536) {
+    a.push_back(a.size());
+  }
+  EXPECT_EQ(3072, a.capacity());
+  EXPECT_EQ(1'000'001, a[0].value);
+  EXPECT_EQ(3'000'000, a[1].value);
+  for (size_t i = 2; i < a.size(); ++i) {
+    ASSERT_EQ(i, a[i].value);
+  }
+}
+
+TEST_F(incremental_growth_test, copy_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  string_vector b = a;
+  EXPECT_FALSE(b.incremental_growth());
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+  a.push_back(value(97));
+  expect_values(a, 98);
+  expect_values(b, 97);
+}
+
+TEST_F(incremental_growth_test, pop_back_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  a.push_back(value(97));
+  a.pop_back();
+  a.pop_back();
+  expect_values(a, 96);
+  a.pop_back();
+  expect_values(a, 95);
+}
+
+TEST_F(incremental_growth_test, other_operations_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  a.insert(as_const(a).begin(), "front");
+  EXPECT_EQ("front", a[0]);
+  EXPECT_EQ(value(0), a[1]);
+  a.erase(as_const(a).begin());
+  expect_values(a, 97);
+  a.push_back(value(97));
+  a.reserve(1000);
+  expect_values(a, 98);
+}
+
+TEST_F(incremental_growth_test, disable_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  a.set_incremental_growth(false);
+  EXPECT_FALSE(a.incremental_growth());
+  expect_values(a, 97);
+  a.push_back(value(97));
+  expect_values(a, 98);
+}
+
+TEST_F(incremental_growth_test, destroy_during_growth) {
+  string_vector a = make_growing(96);
+  a.push_back(value(96));
+  a.clear();
+  EXPECT_TRUE(a.empty());
+  a = make_growing(96);
+  a.push_back(value(96));
+}
+
+TEST_F(incremental_growth_test, destroy_trivial_during_growth) {
+  auto grow = [](socow_vector<int, 2>& a) {
+    a.set_incremental_growth(true);
+    for (int i = 0; i < 1025; ++i) {
+      a.push_back(i);
+    }
+  };
+  {
+    socow_vector<int, 2> destroyed;
+    grow(destroyed);
+  }
+
+  socow_vector<int, 2> a;
+  grow(a);
+  a.clear();
+  EXPECT_TRUE(a.empty());
+  grow(a);
+  for (int i = 0; i < 1025; ++i) {
+    ASSERT_EQ(i, as_const(a)[i]);
+  }
+}
+
+TEST_F(incremental_growth_test, push_back_throw) {
+  counted_vector a;
+  a.set_incremental_growth(true);
+  while (a.size() < 16 || a.size() < a.capacity()) {
+    a.push_back(a.size());
+  }
+  size_t size = a.size();
+  const counted* old_data = as_const(a).data();
+  counted::throw_on_copy = true;
+  EXPECT_THROW(a.push_back(size), std::runtime_error);
+  counted::throw_on_copy = false;
+  EXPECT_EQ(size, a.size());
+  EXPECT_EQ(size, a.capacity());
+  EXPECT_EQ(old_data, as_const(a).data());
+  for (size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(i, a[i].value);
+  }
+}
+
+TEST_F(incremental_growth_test, copy_before_switch) {
+  counted_vector a;
+  grow_until_copying(a, 1536);
+  counted_vector b = a;
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+  b.push_back(b.size());
+  a = counted_vector();
+  while (b.size() <= 1536) {
+    b.push_back(b.size());
+  }
+  for (size_t i = 0; i < b.size(); ++i) {
+    ASSERT_EQ(i, as_const(b)[i].value);
+  }
+}
+
+TEST_F(incremental_growth_test, shared_buffer_is_copied) {
+  string_vector a = make_growing(64);
+  string_vector b = a;
+  a.push_back(value(64));
+  expect_values(a, 65);
+  expect_values(b, 64);
+}
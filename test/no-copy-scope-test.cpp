@@ -0,0 +1,265 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <sstream>
+#include <thread>
+
+using std::as_const;
+
+// Runs `statement` inside a socow_no_copy_scope and expects it to allocate: the process aborts in debug builds,
+// the violation counter grows with NDEBUG.
+#ifdef NDEBUG
+#define EXPECT_NO_COPY_VIOLATION(statement)                                                                          \
+  do {                                                                                                               \
+    uint64_t violations_before = socow_no_copy_scope::violations();                                                  \
+    {                                                                                                                \
+      socow_no_copy_scope scope;                                                                                     \
+      statement;                                                                                                     \
+    }                                                                                                                \
+    EXPECT_LT(violations_before, socow_no_copy_scope::violations());                                                 \
+  } while (false)
+#else
+#define EXPECT_NO_COPY_VIOLATION(statement)                                                                          \
+  EXPECT_DEATH(                                                                                                      \
+      {                                                                                                              \
+        socow_no_copy_scope scope;                                                                                   \
+        statement;                                                                                                   \
+      },                                                                                                             \
+      "inside socow_no_copy_scope")
+#endif
+
+namespace {
+
+using int_vector = socow_vector<int, 3>;
+
+class no_copy_scope_test : public base_test {
+protected:
+  void SetUp() override {
+    base_test::SetUp();
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    violations_before = socow_no_copy_scope::violations();
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(violations_before, socow_no_copy_scope::violations());
+    base_test::TearDown();
+  }
+
+  uint64_t violations_before = 0;
+};
+
+class no_copy_scope_death_test : public no_copy_scope_test {
+protected:
+  void TearDown() override {
+    base_test::TearDown();
+  }
+};
+
+} // namespace
+
+TEST_F(no_copy_scope_test, allowed) {
+  container a = make_vector<element, 3>(10, 20);
+  container small = make_vector<element, 3>(2, 2);
+  socow_no_copy_scope scope;
+
+  container b = a;
+  container c;
+  c = a;
+  container d = small;
+  EXPECT_EQ(0, as_const(b)[0]);
+  EXPECT_EQ(a.size(), std::distance(as_const(b).begin(), as_const(b).end()));
+
+  // Appending behind the shared elements and dropping them don't copy.
+  b.push_back(42);
+  c.pop_back();
+  c.clear();
+  d.push_back(3);
+  d[0] = 1;
+  a.swap(d);
+  a.swap(b);
+}
+
+TEST_F(no_copy_scope_test, unique_writes) {
+  container a = make_vector<element, 3>(10, 20);
+  int_vector b = int_vector::for_overwrite(10);
+  socow_no_copy_scope scope;
+  a[0] = 1;
+  a.front() = 2;
+  a.back() = 3;
+  *a.begin() = 4;
+  a.data()[1] = 5;
+  a.push_back(6);
+  a.insert(as_const(a).begin(), 7);
+  a.erase(as_const(a).begin() + 3);
+  a.reserve(15);
+  a.transform_inplace([](const element&) -> element { return 1; });
+  a.erase_if([](const element& e) { return e == 8; });
+  a.replace_if([](const element& e) { return e == 5; }, 50);
+
+  std::fill(b.begin(), b.end(), 1);
+  b.unique();
+  b.sort();
+}
+
+TEST_F(no_copy_scope_test, nested) {
+  container a = make_vector<element, 3>(10, 10);
+  container b = a;
+  {
+    socow_no_copy_scope outer;
+    {
+      socow_no_copy_scope inner;
+    }
+    container c = a;
+  }
+  b[0] = 1;
+  EXPECT_EQ(0, as_const(a)[0]);
+}
+
+TEST_F(no_copy_scope_test, thread_local) {
+  container a = make_vector<element, 3>(10, 10);
+  socow_no_copy_scope scope;
+  std::thread([&a] {
+    container b = a;
+    b[0] = 1;
+    b.push_back(2);
+  }).join();
+}
+
+TEST_F(no_copy_scope_death_test, capacity_constructor) {
+  EXPECT_NO_COPY_VIOLATION(container(10));
+}
+
+TEST_F(no_copy_scope_death_test, for_overwrite) {
+  EXPECT_NO_COPY_VIOLATION(int_vector::for_overwrite(10));
+}
+
+TEST_F(no_copy_scope_death_test, push_back_spill) {
+  container a = make_vector<element, 3>(3, 3);
+  EXPECT_NO_COPY_VIOLATION(a.push_back(4));
+}
+
+TEST_F(no_copy_scope_death_test, push_back_reallocation) {
+  container a = make_vector<element, 3>(10, 10);
+  EXPECT_NO_COPY_VIOLATION(a.push_back(4));
+}
+
+TEST_F(no_copy_scope_death_test, push_back_shared) {
+  container a = make_vector<element, 3>(10, 20);
+  container b = a;
+  a.pop_back();
+  EXPECT_NO_COPY_VIOLATION(a.push_back(4));
+}
+
+TEST_F(no_copy_scope_death_test, push_back_incremental_growth) {
+  int_vector a = int_vector::for_overwrite(10);
+  a.set_incremental_growth(true);
+  EXPECT_NO_COPY_VIOLATION(a.push_back(4));
+}
+
+TEST_F(no_copy_scope_death_test, insert) {
+  container a = make_vector<element, 3>(3, 3);
+  EXPECT_NO_COPY_VIOLATION(a.insert(as_const(a).begin(), 4));
+  container b = make_vector<element, 3>(10, 20);
+  container c = b;
+  EXPECT_NO_COPY_VIOLATION(b.insert(as_const(b).begin(), 4));
+}
+
+TEST_F(no_copy_scope_death_test, element_access) {
+  // Every statement writes through a fresh copy of `a`, which shares its buffer.
+  container a = make_vector<element, 3>(10, 10);
+  EXPECT_NO_COPY_VIOLATION(container{a}[0] = 1);
+  EXPECT_NO_COPY_VIOLATION(container{a}.front() = 1);
+  EXPECT_NO_COPY_VIOLATION(container{a}.back() = 1);
+  EXPECT_NO_COPY_VIOLATION(container{a}.data());
+  EXPECT_NO_COPY_VIOLATION(container{a}.begin());
+  EXPECT_NO_COPY_VIOLATION(container{a}.end());
+}
+
+TEST_F(no_copy_scope_death_test, erase) {
+  container a = make_vector<element, 3>(10, 10);
+  container b = a;
+  container c = a;
+  EXPECT_NO_COPY_VIOLATION(b.erase(as_const(b).begin()));
+  EXPECT_NO_COPY_VIOLATION(c.erase(as_const(c).begin() + 2, as_const(c).begin() + 4));
+}
+
+TEST_F(no_copy_scope_death_test, reserve) {
+  container a = make_vector<element, 3>(10, 10);
+  EXPECT_NO_COPY_VIOLATION(a.reserve(20));
+  container b = make_vector<element, 3>(10, 20);
+  container c = b;
+  b.pop_back();
+  EXPECT_NO_COPY_VIOLATION(b.reserve(15));
+}
+
+TEST_F(no_copy_scope_death_test, shrink_to_fit) {
+  container a = make_vector<element, 3>(10, 20);
+  EXPECT_NO_COPY_VIOLATION(a.shrink_to_fit());
+}
+
+TEST_F(no_copy_scope_death_test, fused_algorithms) {
+  container a = make_vector<element, 3>(10, 10);
+  EXPECT_NO_COPY_VIOLATION(container{a}.transform_inplace([](const element&) -> element { return 1; }));
+  EXPECT_NO_COPY_VIOLATION(container{a}.erase_if([](const element& e) { return e == 1; }));
+  EXPECT_NO_COPY_VIOLATION(container{a}.replace_if([](const element& e) { return e == 1; }, 1));
+
+  int_vector b = int_vector::for_overwrite(10);
+  std::fill(b.begin(), b.end(), 1);
+  b[9] = 2;
+  EXPECT_NO_COPY_VIOLATION(int_vector{b}.unique());
+  EXPECT_NO_COPY_VIOLATION(int_vector{b}.sort(std::greater<>()));
+}
+
+TEST_F(no_copy_scope_death_test, apply) {
+  container a = make_vector<element, 3>(10, 10);
+  container b = a;
+  container::edit_plan plan;
+  plan.erase(0, 1);
+  EXPECT_NO_COPY_VIOLATION(a.apply(std::move(plan)));
+  container c = make_vector<element, 3>(3, 3);
+  container::edit_plan grow;
+  grow.insert(0, 1);
+  EXPECT_NO_COPY_VIOLATION(c.apply(std::move(grow)));
+}
+
+TEST_F(no_copy_scope_death_test, release) {
+  container a = make_vector<element, 3>(2, 2);
+  EXPECT_NO_COPY_VIOLATION({
+    auto released = a.release();
+    std::destroy_n(released.data, released.size);
+    released.deleter(released.data);
+  });
+}
+
+TEST_F(no_copy_scope_death_test, unshare_async) {
+  int_vector a = int_vector::for_overwrite(10);
+  int_vector b = a;
+  EXPECT_NO_COPY_VIOLATION(a.unshare_async([](auto task) { task(); }));
+}
+
+TEST_F(no_copy_scope_death_test, trim) {
+  container a = make_vector<element, 3>(10, 100);
+  a.set_trimmable(true);
+  EXPECT_NO_COPY_VIOLATION(socow_trim());
+}
+
+TEST_F(no_copy_scope_death_test, deserialize) {
+  int_vector a = int_vector::for_overwrite(10);
+  std::fill(a.begin(), a.end(), 1);
+  std::stringstream ss;
+  a.serialize(ss);
+  EXPECT_NO_COPY_VIOLATION(int_vector::deserialize(ss));
+}
+
+#if SOCOW_HAS_MEMFD
+TEST_F(no_copy_scope_death_test, paged_clone) {
+  socow_config::paged_cow_threshold = 4096;
+  int_vector a = int_vector::for_overwrite(4096);
+  int_vector b = a;
+  socow_config::paged_cow_threshold = 0;
+  EXPECT_NO_COPY_VIOLATION(a[0] = 1);
+}
+#endif
@@ -0,0 +1,174 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::as_const;
+
+#if SOCOW_HAS_MEMFD
+namespace {
+
+using int_vector = socow_vector<int, 3>;
+
+class paged_cow_test : public base_test {
+protected:
+  void SetUp() override {
+    base_test::SetUp();
+    socow_config::paged_cow_threshold = 4096;
+  }
+
+  void TearDown() override {
+    socow_config::paged_cow_threshold = 0;
+    base_test::TearDown();
+  }
+};
+
+int_vector make_ints(size_t n) {
+  int_vector a;
+  a.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(static_cast<int>(i));
+  }
+  return a;
+}
+
+// Anonymous (i.e. privately copied) memory of the mapping containing `address`, in KiB.
+size_t anonymous_kib(const void* address) {
+  std::ifstream smaps("/proc/self/smaps");
+  auto target = reinterpret_cast<uintptr_t>(address);
+  bool inside = false;
+  for (std::string line; std::getline(smaps, line);) {
+    uintptr_t begin = 0, end = 0;
+    char dash = 0;
+    std::istringstream header(line);
+    if (header >> std::hex >> begin >> dash >> end && dash == '-') {
+      inside = begin <= target && target < end;
+    } else if (inside && line.rfind("Anonymous:", 0) == 0) {
+      return std::stoul(line.substr(10));
+    }
+  }
+  return SIZE_MAX;
+}
+
+} // namespace
+
+TEST_F(paged_cow_test, small_buffers_stay_on_heap) {
+  int_vector a = make_ints(100);
+  EXPECT_NE(0, reinterpret_cast<uintptr_t>(as_const(a).data()) % 4096);
+}
+
+TEST_F(paged_cow_test, big_buffers_are_page_aligned) {
+  int_vector a = make_ints(10'000);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(as_const(a).data()) % 4096);
+  EXPECT_EQ(10'000, a.capacity());
+}
+
+TEST_F(paged_cow_test, unshare_copies_only_written_pages) {
+  constexpr size_t N = 4 << 20;
+
+  int_vector a = make_ints(N);
+  int_vector b = a;
+
+  b[N / 2] = -1;
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(N, b.capacity());
+  EXPECT_GE(64, anonymous_kib(as_const(b).data()));
+
+  EXPECT_EQ(static_cast<int>(N / 2), as_const(a)[N / 2]);
+  EXPECT_EQ(-1, as_const(b)[N / 2]);
+  for (size_t i = 0; i < N; i += 4099) {
+    ASSERT_EQ(static_cast<int>(i), as_const(b)[i]);
+  }
+}
+
+TEST_F(paged_cow_test, writes_to_original_do_not_leak_into_copy) {
+  constexpr size_t N = 100'000;
+
+  int_vector a = make_ints(N);
+  int_vector b = a;
+  b[0] = -1;
+
+  const int* a_data = as_const(a).data();
+  a[1] = -2;
+  EXPECT_EQ(a_data, as_const(a).data());
+  EXPECT_EQ(-2, as_const(a)[1]);
+  EXPECT_EQ(1, as_const(b)[1]);
+  EXPECT_EQ(0, as_const(a)[0]);
+  EXPECT_EQ(-1, as_const(b)[0]);
+
+  int_vector c = a;
+  c[2] = -3;
+  EXPECT_EQ(2, as_const(a)[2]);
+  EXPECT_EQ(-2, as_const(c)[1]);
+  EXPECT_EQ(-3, as_const(c)[2]);
+}
+
+TEST_F(paged_cow_test, checkpoint_then_mutate) {
+  constexpr size_t N = 100'000, K = 10;
+
+  int_vector state = make_ints(N);
+  std::vector<int_vector> checkpoints;
+  for (size_t k = 0; k < K; ++k) {
+    checkpoints.push_back(state);
+    state[k] = -static_cast<int>(k) - 1;
+    state.push_back(static_cast<int>(k));
+  }
+
+  for (size_t k = 0; k < K; ++k) {
+    ASSERT_EQ(N + k, checkpoints[k].size());
+    for (size_t i = 0; i < K; ++i) {
+      ASSERT_EQ(i < k ? -static_cast<int>(i) - 1 : static_cast<int>(i), as_const(checkpoints[k])[i]);
+    }
+  }
+  EXPECT_EQ(N + K, state.size());
+  EXPECT_EQ(static_cast<int>(K - 1), as_const(state).back());
+}
+
+TEST_F(paged_cow_test, modifications) {
+  constexpr size_t N = 50'000;
+
+  int_vector a = make_ints(N);
+  int_vector b = a;
+  b.erase(as_const(b).begin(), as_const(b).begin() + 10);
+  a.insert(as_const(a).begin(), -1);
+  EXPECT_EQ(N + 1, a.size());
+  EXPECT_EQ(-1, as_const(a)[0]);
+  EXPECT_EQ(N - 10, b.size());
+  EXPECT_EQ(10, as_const(b)[0]);
+
+  b.shrink_to_fit();
+  EXPECT_EQ(b.size(), b.capacity());
+  b.erase(as_const(b).begin() + 2, as_const(b).end());
+  b.shrink_to_fit();
+  EXPECT_EQ(2, b.size());
+  EXPECT_EQ(11, as_const(b)[1]);
+
+  a.clear();
+  EXPECT_TRUE(a.empty());
+}
+
+TEST_F(paged_cow_test, release) {
+  int_vector a = make_ints(10'000);
+  int_vector b = a;
+  int_vector::released_buffer released = a.release();
+  released.data[0] = -1;
+  EXPECT_EQ(0, as_const(b)[0]);
+  released.deleter(released.data);
+}
+
+TEST_F(paged_cow_test, serialization_round_trip) {
+  int_vector a = make_ints(10'000);
+  std::stringstream ss;
+  a.serialize(ss);
+  int_vector b = int_vector::deserialize(ss);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(as_const(b).data()) % 4096);
+  for (size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(as_const(a)[i], as_const(b)[i]);
+  }
+}
+#endif
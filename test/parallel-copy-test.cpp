@@ -0,0 +1,208 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using std::as_const;
+
+namespace {
+
+class parallel_copy_test : public base_test {
+protected:
+  void SetUp() override {
+    base_test::SetUp();
+    socow_config::parallel_copy_threshold = 1024;
+    socow_config::parallel_copy_threads = 4;
+  }
+
+  void TearDown() override {
+    socow_config::parallel_copy_threshold = 0;
+    socow_config::parallel_copy_threads = 0;
+    base_test::TearDown();
+  }
+};
+
+// `element` isn't thread-safe, so the copies made on other threads are tracked here.
+struct tracked {
+  tracked(size_t value) : value(value) {
+    ++instances;
+  }
+
+  tracked(const tracked& other) : value(other.value) {
+    if (value == throw_on_value) {
+      throw std::runtime_error("copy");
+    }
+    ++instances;
+  }
+
+  tracked& operator=(const tracked&) = default;
+
+  ~tracked() {
+    --instances;
+  }
+
+  size_t value;
+
+  static inline std::atomic<size_t> instances = 0;
+  static inline std::atomic<size_t> throw_on_value = SIZE_MAX;
+};
+
+// Other tests copy std::string vectors on one thread, so the trait is specialized for this wrapper instead.
+struct text {
+  text(std::string value) : value(std::move(value)) {}
+
+  friend bool operator==(const text&, const text&) = default;
+
+  std::string value;
+};
+
+// Counts the threads that ever copied it, by their first copy.
+struct thread_counted {
+  thread_counted(size_t value) : value(value) {}
+
+  thread_counted(const thread_counted& other) : value(other.value) {
+    thread_local bool seen = (++threads, true);
+    (void)seen;
+  }
+
+  thread_counted& operator=(const thread_counted&) = default;
+
+  size_t value;
+
+  static inline std::atomic<size_t> threads = 0;
+};
+
+// Unlike `tracked`, doesn't opt into parallel copies.
+struct thread_checked {
+  thread_checked(size_t value) : value(value) {}
+
+  thread_checked(const thread_checked& other) : value(other.value) {
+    EXPECT_EQ(owner, std::this_thread::get_id());
+  }
+
+  thread_checked& operator=(const thread_checked&) = default;
+
+  size_t value;
+
+  static inline std::thread::id owner = std::this_thread::get_id();
+};
+
+} // namespace
+
+template <>
+struct socow_thread_copyable<text> : std::true_type {};
+
+template <>
+struct socow_thread_copyable<tracked> : std::true_type {};
+
+template <>
+struct socow_thread_copyable<thread_counted> : std::true_type {};
+
+TEST_F(parallel_copy_test, unshare_trivial) {
+  socow_vector<size_t, 3> a = make_vector<size_t, 3>(10'000, 10'000);
+  socow_vector<size_t, 3> b = a;
+  b[0] = 42;
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(42, as_const(b)[0]);
+  EXPECT_EQ(0, as_const(a)[0]);
+  for (size_t i = 1; i < b.size(); ++i) {
+    ASSERT_EQ(i, as_const(b)[i]);
+  }
+}
+
+TEST_F(parallel_copy_test, unshare_strings) {
+  socow_vector<text, 3> a;
+  for (size_t i = 0; i < 1'000; ++i) {
+    a.push_back("parallel-copy-value-" + std::to_string(i));
+  }
+  socow_vector<text, 3> b = a;
+  b[0] = text("changed");
+  EXPECT_EQ("parallel-copy-value-0", as_const(a)[0].value);
+  for (size_t i = 1; i < b.size(); ++i) {
+    ASSERT_EQ(as_const(a)[i], as_const(b)[i]);
+  }
+}
+
+TEST_F(parallel_copy_test, more_threads_than_elements) {
+  socow_config::parallel_copy_threshold = 1;
+  socow_config::parallel_copy_threads = 64;
+  socow_vector<text, 3> a;
+  for (size_t i = 0; i < 5; ++i) {
+    a.push_back(std::to_string(i));
+  }
+  a.reserve(100);
+  a.shrink_to_fit();
+  ASSERT_EQ(5, a.capacity());
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_EQ(std::to_string(i), as_const(a)[i].value);
+  }
+}
+
+TEST_F(parallel_copy_test, copy_throw) {
+  size_t before = tracked::instances;
+  {
+    socow_vector<tracked, 3> a = make_vector<tracked, 3>(1'000, 1'000);
+    socow_vector<tracked, 3> b = a;
+    size_t instances = tracked::instances;
+    for (size_t value : {0, 10, 500, 999}) {
+      tracked::throw_on_value = value;
+      EXPECT_THROW(b[1].value = 0, std::runtime_error);
+      tracked::throw_on_value = SIZE_MAX;
+      EXPECT_EQ(instances, tracked::instances);
+      EXPECT_EQ(as_const(a).data(), as_const(b).data());
+    }
+    b[1].value = 0;
+    EXPECT_EQ(1, as_const(a)[1].value);
+  }
+  EXPECT_EQ(before, tracked::instances);
+}
+
+TEST_F(parallel_copy_test, not_thread_copyable) {
+  socow_vector<thread_checked, 3> a = make_vector<thread_checked, 3>(10'000, 10'000);
+  socow_vector<thread_checked, 3> b = a;
+  b[0].value = 42;
+  EXPECT_EQ(0, as_const(a)[0].value);
+  for (size_t i = 1; i < b.size(); ++i) {
+    ASSERT_EQ(i, as_const(b)[i].value);
+  }
+}
+
+TEST_F(parallel_copy_test, nested_vectors) {
+  using inner = socow_vector<int, 1>;
+  static_assert(!socow_thread_copyable<inner>::value);
+  socow_vector<inner, 3> a;
+  for (int i = 0; i < 1'000; ++i) {
+    inner values;
+    for (int j = 0; j < 10; ++j) {
+      values.push_back(i);
+    }
+    a.push_back(values);
+  }
+  socow_vector<inner, 3> b = a;
+  b[0][0] = 42;
+  socow_vector<inner, 3> c = b;
+  c[1][0] = 43;
+  EXPECT_EQ(0, as_const(a)[0][0]);
+  EXPECT_EQ(42, as_const(b)[0][0]);
+  EXPECT_EQ(1, as_const(b)[1][0]);
+  EXPECT_EQ(43, as_const(c)[1][0]);
+  for (int i = 2; i < 1'000; ++i) {
+    ASSERT_EQ(as_const(a)[i].data(), as_const(c)[i].data());
+  }
+}
+
+TEST_F(parallel_copy_test, workers_are_kept) {
+  // The most any test here asks for, so the bound holds whatever the pool has grown to.
+  socow_config::parallel_copy_threads = 64;
+  socow_vector<thread_counted, 3> a = make_vector<thread_counted, 3>(10'000, 10'000);
+  for (size_t i = 0; i < 10; ++i) {
+    socow_vector<thread_counted, 3> b = a;
+    b[0].value = i;
+    EXPECT_EQ(0, as_const(a)[0].value);
+  }
+  EXPECT_LE(thread_counted::threads, 64);
+}
@@ -0,0 +1,200 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+using std::as_const;
+using int_vector = socow_vector<int, 3>;
+
+class serialization_test : public base_test {};
+
+namespace {
+
+int_vector make_ints(size_t n) {
+  int_vector a;
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(static_cast<int>(3 * i + 1));
+  }
+  return a;
+}
+
+// A stream that can't seek, like a pipe.
+class unseekable_buf : public std::stringbuf {
+public:
+  using std::stringbuf::stringbuf;
+
+protected:
+  pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override {
+    return pos_type(off_type(-1));
+  }
+
+  pos_type seekpos(pos_type, std::ios_base::openmode) override {
+    return pos_type(off_type(-1));
+  }
+};
+
+template <size_t SMALL_SIZE>
+void expect_equal(const socow_vector<int, SMALL_SIZE>& a, const socow_vector<int, SMALL_SIZE>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(a[i], b[i]);
+  }
+}
+
+} // namespace
+
+TEST_F(serialization_test, stream_round_trip_empty) {
+  int_vector a;
+  std::stringstream ss;
+  a.serialize(ss);
+  EXPECT_EQ(sizeof(socow_file_header), ss.str().size());
+
+  int_vector b = int_vector::deserialize(ss);
+  EXPECT_TRUE(b.empty());
+}
+
+TEST_F(serialization_test, stream_round_trip_small) {
+  int_vector a = make_ints(2);
+  std::stringstream ss;
+  a.serialize(ss);
+
+  int_vector b = int_vector::deserialize(ss);
+  EXPECT_EQ(3, b.capacity());
+  expect_equal(a, b);
+}
+
+TEST_F(serialization_test, stream_round_trip_big) {
+  constexpr size_t N = 10'000;
+
+  int_vector a = make_ints(N);
+  std::stringstream ss;
+  a.serialize(ss);
+  EXPECT_EQ(sizeof(socow_file_header) + N * sizeof(int), ss.str().size());
+
+  int_vector b = int_vector::deserialize(ss);
+  EXPECT_EQ(N, b.capacity());
+  expect_equal(a, b);
+}
+
+TEST_F(serialization_test, serialize_does_not_unshare) {
+  int_vector a = make_ints(100);
+  int_vector b = a;
+  std::stringstream ss;
+  b.serialize(ss);
+  EXPECT_EQ(as_const(a).data(), as_const(b).data());
+}
+
+TEST_F(serialization_test, several_vectors_in_one_stream) {
+  int_vector a = make_ints(10);
+  int_vector b = make_ints(1);
+  std::stringstream ss;
+  a.serialize(ss);
+  b.serialize(ss);
+
+  expect_equal(a, int_vector::deserialize(ss));
+  expect_equal(b, int_vector::deserialize(ss));
+}
+
+TEST_F(serialization_test, bad_magic) {
+  std::stringstream ss;
+  make_ints(10).serialize(ss);
+  std::string bytes = ss.str();
+  bytes[0] = 'X';
+  std::stringstream corrupted(bytes);
+  EXPECT_THROW(int_vector::deserialize(corrupted), socow_format_error);
+}
+
+TEST_F(serialization_test, element_size_mismatch) {
+  std::stringstream ss;
+  make_ints(10).serialize(ss);
+  EXPECT_THROW((socow_vector<long long, 3>::deserialize(ss)), socow_format_error);
+}
+
+TEST_F(serialization_test, checksum_mismatch) {
+  std::stringstream ss;
+  make_ints(10).serialize(ss);
+  std::string bytes = ss.str();
+  bytes[sizeof(socow_file_header) + 5] ^= 1;
+  std::stringstream corrupted(bytes);
+  EXPECT_THROW(int_vector::deserialize(corrupted), socow_format_error);
+}
+
+TEST_F(serialization_test, truncated_payload) {
+  std::stringstream ss;
+  make_ints(10).serialize(ss);
+  std::string bytes = ss.str();
+  bytes.resize(bytes.size() - 1);
+  std::stringstream truncated(bytes);
+  EXPECT_THROW(int_vector::deserialize(truncated), socow_format_error);
+}
+
+TEST_F(serialization_test, corrupt_count_fails_without_allocating_it) {
+  std::stringstream ss;
+  make_ints(10).serialize(ss);
+  std::string bytes = ss.str();
+  uint64_t count = uint64_t(1) << 40;
+  std::memcpy(bytes.data() + offsetof(socow_file_header, count), &count, sizeof(count));
+  std::stringstream corrupted(bytes);
+  EXPECT_THROW(int_vector::deserialize(corrupted), socow_format_error);
+  // A seekable stream is checked before any of the payload is read.
+  EXPECT_EQ(std::streampos(sizeof(socow_file_header)), corrupted.tellg());
+}
+
+TEST_F(serialization_test, unseekable_stream) {
+  constexpr size_t N = 300'000;
+
+  int_vector a = make_ints(N);
+  std::stringstream ss;
+  a.serialize(ss);
+  std::string bytes = ss.str();
+  {
+    unseekable_buf buf(bytes);
+    std::istream in(&buf);
+    expect_equal(a, int_vector::deserialize(in));
+  }
+  bytes.resize(bytes.size() - 1);
+  unseekable_buf buf(bytes);
+  std::istream in(&buf);
+  EXPECT_THROW(int_vector::deserialize(in), socow_format_error);
+}
+
+#if SOCOW_HAS_POSIX_IO
+TEST_F(serialization_test, fd_corrupt_count) {
+  std::FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  int fd = fileno(file);
+
+  int none = 0;
+  socow_file_header header = socow_detail::make_header(sizeof(int), 0, &none);
+  header.count = uint64_t(1) << 40;
+  ASSERT_EQ(sizeof(header), ::write(fd, &header, sizeof(header)));
+  ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+
+  EXPECT_THROW(int_vector::deserialize(fd), socow_format_error);
+  std::fclose(file);
+}
+
+TEST_F(serialization_test, fd_round_trip) {
+  constexpr size_t N = 100'000;
+
+  std::FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  int fd = fileno(file);
+
+  int_vector a = make_ints(N);
+  int_vector small = make_ints(3);
+  a.serialize(fd);
+  small.serialize(fd);
+  ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+
+  expect_equal(a, int_vector::deserialize(fd));
+  expect_equal(small, int_vector::deserialize(fd));
+  EXPECT_THROW(int_vector::deserialize(fd), socow_format_error);
+  std::fclose(file);
+}
+#endif
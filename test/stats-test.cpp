@@ -0,0 +1,152 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+using std::as_const;
+
+namespace {
+
+using vector = socow_vector<item, 2>;
+
+class stats_test : public ::testing::Test {
+protected:
+  void SetUp() override {
+    before = socow_stats::snapshot();
+  }
+
+  uint64_t counted(socow_counter counter) const {
+    return socow_stats::snapshot()[counter] - before[counter];
+  }
+
+  socow_stats::snapshot_t before;
+};
+
+} // namespace
+
+TEST_F(stats_test, shared_copies) {
+  vector a = make_vector(10);
+  vector b = a;
+  vector c;
+  c = a;
+  vector small = make_vector(2);
+  vector d = small;
+  EXPECT_EQ(2, counted(socow_counter::shared_copies));
+  EXPECT_EQ(0, counted(socow_counter::unshares));
+}
+
+TEST_F(stats_test, unshares) {
+  vector a = make_vector(10);
+  vector b = a;
+  b[0] = 42;
+  EXPECT_EQ(1, counted(socow_counter::unshares));
+  EXPECT_EQ(10 * sizeof(item), counted(socow_counter::unshare_bytes));
+
+  vector c = a;
+  c.erase(as_const(c).begin());
+  vector d = a;
+  d.insert(as_const(d).begin(), 7);
+  EXPECT_EQ(3, counted(socow_counter::unshares));
+  EXPECT_EQ(29 * sizeof(item), counted(socow_counter::unshare_bytes));
+
+  // Writing into a buffer nobody else shares is free.
+  b[1] = 43;
+  EXPECT_EQ(3, counted(socow_counter::unshares));
+}
+
+TEST_F(stats_test, spills_and_shrinks) {
+  vector a = make_vector(2);
+  EXPECT_EQ(0, counted(socow_counter::spills));
+  a.push_back(2);
+  EXPECT_EQ(1, counted(socow_counter::spills));
+  a.pop_back();
+  a.shrink_to_fit();
+  EXPECT_EQ(1, counted(socow_counter::shrinks_to_small));
+  a.reserve(100);
+  EXPECT_EQ(2, counted(socow_counter::spills));
+  EXPECT_EQ(0, counted(socow_counter::reallocations));
+}
+
+TEST_F(stats_test, reallocations) {
+  vector a = make_vector(3);
+  ASSERT_EQ(4, a.capacity());
+  for (size_t i = 3; i < 17; ++i) {
+    a.push_back(static_cast<int>(i));
+  }
+  // 4 -> 8 -> 16 -> 32
+  EXPECT_EQ(3, counted(socow_counter::reallocations));
+  EXPECT_EQ(28 * sizeof(item), counted(socow_counter::reallocated_from_bytes));
+  EXPECT_EQ(56 * sizeof(item), counted(socow_counter::reallocated_to_bytes));
+
+  a.shrink_to_fit();
+  EXPECT_EQ(4, counted(socow_counter::reallocations));
+  EXPECT_EQ(60 * sizeof(item), counted(socow_counter::reallocated_from_bytes));
+  EXPECT_EQ(73 * sizeof(item), counted(socow_counter::reallocated_to_bytes));
+}
+
+TEST_F(stats_test, heap_bytes) {
+  {
+    vector a;
+    a.reserve(8);
+    for (int i = 0; i < 5; ++i) {
+      a.push_back(i);
+    }
+    EXPECT_EQ(8 * sizeof(item), counted(socow_counter::heap_bytes_allocated));
+    EXPECT_EQ(0, counted(socow_counter::heap_bytes_freed));
+  }
+  EXPECT_EQ(8 * sizeof(item), counted(socow_counter::heap_bytes_freed));
+  EXPECT_EQ(3 * sizeof(item), counted(socow_counter::wasted_capacity_bytes));
+}
+
+TEST_F(stats_test, heap_bytes_incremental_growth) {
+  {
+    socow_vector<long, 2> a;
+    a.set_incremental_growth(true);
+    for (long i = 0; i < 100'000; ++i) {
+      a.push_back(i);
+    }
+    EXPECT_LE(100'000 * sizeof(long),
+              counted(socow_counter::heap_bytes_allocated) - counted(socow_counter::heap_bytes_freed));
+  }
+  EXPECT_EQ(counted(socow_counter::heap_bytes_allocated), counted(socow_counter::heap_bytes_freed));
+}
+
+#if SOCOW_HAS_MEMFD
+TEST_F(stats_test, heap_bytes_paged) {
+  socow_config::paged_cow_threshold = 4096;
+  {
+    socow_vector<long, 2> a;
+    a.reserve(100'000);
+    a.push_back(1);
+    EXPECT_LE(100'000 * sizeof(long), counted(socow_counter::heap_bytes_allocated));
+    socow_vector<long, 2> b = a;
+    b[0] = 2;
+    EXPECT_EQ(0, counted(socow_counter::heap_bytes_freed));
+  }
+  socow_config::paged_cow_threshold = 0;
+  EXPECT_EQ(counted(socow_counter::heap_bytes_allocated), counted(socow_counter::heap_bytes_freed));
+}
+#endif
+
+TEST_F(stats_test, threads) {
+  vector a = make_vector(10);
+  std::thread([&a] {
+    for (size_t i = 0; i < 100; ++i) {
+      vector b = a;
+    }
+  }).join();
+  EXPECT_EQ(100, counted(socow_counter::shared_copies));
+}
+
+TEST_F(stats_test, prometheus) {
+  socow_stats::snapshot_t snapshot;
+  snapshot.values[static_cast<size_t>(socow_counter::unshares)] = 12;
+  std::ostringstream out;
+  socow_stats::write_prometheus(out, snapshot, "app_socow_");
+  std::string text = out.str();
+  EXPECT_NE(std::string::npos, text.find("# TYPE app_socow_unshares_total counter\napp_socow_unshares_total 12\n"));
+  EXPECT_NE(std::string::npos, text.find("app_socow_wasted_capacity_bytes_total 0\n"));
+}
@@ -0,0 +1,119 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using std::as_const;
+
+#if SOCOW_HAS_STREAMING_COPY
+namespace {
+
+class streaming_copy_test : public base_test {
+protected:
+  void SetUp() override {
+    base_test::SetUp();
+    socow_config::streaming_copy_threshold = 4096;
+  }
+
+  void TearDown() override {
+    socow_config::streaming_copy_threshold = 0;
+    base_test::TearDown();
+  }
+};
+
+struct kernel {
+  const char* name;
+  const char* feature;
+  socow_detail::streaming_kernel function;
+};
+
+const kernel KERNELS[] = {
+    {"sse2", "sse2", &socow_detail::streaming_copy_sse2},
+    {"avx2", "avx2", &socow_detail::streaming_copy_avx2},
+    {"avx512", "avx512f", &socow_detail::streaming_copy_avx512},
+};
+
+bool supported(const kernel& k) {
+  __builtin_cpu_init();
+  return std::string_view(k.feature) == "sse2"  ? __builtin_cpu_supports("sse2")
+         : std::string_view(k.feature) == "avx2" ? __builtin_cpu_supports("avx2")
+                                                 : __builtin_cpu_supports("avx512f");
+}
+
+socow_vector<uint32_t, 3> make_ints(size_t n) {
+  socow_vector<uint32_t, 3> a;
+  a.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(static_cast<uint32_t>(i * 2654435761u));
+  }
+  return a;
+}
+
+} // namespace
+
+TEST_F(streaming_copy_test, every_alignment_and_size) {
+  std::vector<unsigned char> source(4096 + 64), target(4096 + 128);
+  for (size_t i = 0; i < source.size(); ++i) {
+    source[i] = static_cast<unsigned char>(i * 7 + 1);
+  }
+  for (const kernel& k : KERNELS) {
+    if (!supported(k)) {
+      continue;
+    }
+    SCOPED_TRACE(k.name);
+    for (size_t offset = 0; offset < 64; offset += 7) {
+      for (size_t bytes : {0, 1, 63, 64, 65, 127, 200, 1000, 4096}) {
+        std::fill(target.begin(), target.end(), 0);
+        socow_detail::streaming_copy(target.data() + offset, source.data() + 3, bytes, k.function);
+        ASSERT_TRUE(std::equal(source.begin() + 3, source.begin() + 3 + bytes, target.begin() + offset));
+        ASSERT_TRUE(std::all_of(target.begin(), target.begin() + offset, [](auto c) { return c == 0; }));
+        ASSERT_TRUE(std::all_of(target.begin() + offset + bytes, target.end(), [](auto c) { return c == 0; }));
+      }
+    }
+  }
+}
+
+TEST_F(streaming_copy_test, unshare) {
+  socow_vector<uint32_t, 3> a = make_ints(100'000);
+  socow_vector<uint32_t, 3> b = a;
+  b[0] = 42;
+  EXPECT_NE(as_const(a).data(), as_const(b).data());
+  EXPECT_EQ(42, as_const(b)[0]);
+  for (size_t i = 1; i < b.size(); ++i) {
+    ASSERT_EQ(as_const(a)[i], as_const(b)[i]);
+  }
+}
+
+TEST_F(streaming_copy_test, growth) {
+  socow_vector<uint32_t, 3> a = make_ints(10'000);
+  a.shrink_to_fit();
+  a.insert(as_const(a).begin() + 5'000, 42);
+  socow_vector<uint32_t, 3> expected = make_ints(10'000);
+  ASSERT_EQ(10'001, a.size());
+  EXPECT_EQ(42, as_const(a)[5'000]);
+  for (size_t i = 0; i < 5'000; ++i) {
+    ASSERT_EQ(as_const(expected)[i], as_const(a)[i]);
+  }
+  for (size_t i = 5'000; i < 10'000; ++i) {
+    ASSERT_EQ(as_const(expected)[i], as_const(a)[i + 1]);
+  }
+}
+
+TEST_F(streaming_copy_test, with_parallel_copy) {
+  socow_config::parallel_copy_threshold = 4096;
+  socow_config::parallel_copy_threads = 3;
+  socow_vector<uint32_t, 3> a = make_ints(100'001);
+  a.reserve(200'000);
+  socow_config::parallel_copy_threshold = 0;
+  socow_config::parallel_copy_threads = 0;
+  socow_vector<uint32_t, 3> expected = make_ints(100'001);
+  for (size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(as_const(expected)[i], as_const(a)[i]);
+  }
+}
+#endif
@@ -84,3 +84,21 @@ void expect_empty_storage(const socow_vector<element, SMALL_SIZE>& a) {
   EXPECT_EQ(0, a.size());
   expect_static_storage(a);
 }
+
+// An element type without the checks of `element`.
+struct item {
+  item(int value) : value(value) {}
+
+  int value;
+};
+
+// A vector of the values 0, 1, ..., n - 1, reserved for `capacity` elements first.
+template <typename T = item, size_t SMALL_SIZE = 2>
+socow_vector<T, SMALL_SIZE> make_vector(size_t n, size_t capacity = 0) {
+  socow_vector<T, SMALL_SIZE> a;
+  a.reserve(capacity);
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(T(i));
+  }
+  return a;
+}
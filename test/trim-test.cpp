@@ -0,0 +1,198 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <system_error>
+
+using std::as_const;
+
+namespace {
+
+class trim_test : public base_test {};
+
+// A vector of n elements whose buffer grew to `capacity`.
+container make_grown(size_t n, size_t capacity) {
+  container a;
+  a.reserve(capacity);
+  for (size_t i = 0; i < n; ++i) {
+    a.push_back(i + 100);
+  }
+  return a;
+}
+
+void expect_values(const container& a, size_t n) {
+  ASSERT_EQ(n, a.size());
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(i + 100, as_const(a)[i]);
+  }
+}
+
+} // namespace
+
+TEST_F(trim_test, only_registered) {
+  container a = make_grown(10, 100);
+  container b = make_grown(10, 100);
+  b.set_trimmable(true);
+  EXPECT_TRUE(b.trimmable());
+  EXPECT_FALSE(a.trimmable());
+
+  EXPECT_EQ(90 * sizeof(element), socow_trim());
+  EXPECT_EQ(100, a.capacity());
+  EXPECT_EQ(10, b.capacity());
+  expect_values(b, 10);
+
+  EXPECT_EQ(0, socow_trim());
+}
+
+TEST_F(trim_test, moves_to_small_buffer) {
+  container a = make_grown(2, 50);
+  a.set_trimmable(true);
+  EXPECT_EQ(50 * sizeof(element), socow_trim());
+  expect_static_storage(a);
+  expect_values(a, 2);
+}
+
+TEST_F(trim_test, empty) {
+  container a = make_grown(20, 20);
+  a.set_trimmable(true);
+  EXPECT_EQ(0, socow_trim());
+  a.clear();
+  EXPECT_EQ(20 * sizeof(element), socow_trim());
+  expect_empty_storage(a);
+}
+
+TEST_F(trim_test, not_half_empty) {
+  container a = make_grown(60, 100);
+  a.set_trimmable(true);
+  EXPECT_EQ(0, socow_trim());
+  EXPECT_EQ(100, a.capacity());
+  for (size_t i = 0; i < 10; ++i) {
+    a.pop_back();
+  }
+  EXPECT_EQ(50 * sizeof(element), socow_trim());
+  EXPECT_EQ(50, a.capacity());
+}
+
+TEST_F(trim_test, shared) {
+  container a = make_grown(10, 100);
+  a.set_trimmable(true);
+  container b = a;
+  immutable_guard g(a, b);
+  EXPECT_EQ(0, socow_trim());
+}
+
+TEST_F(trim_test, budget) {
+  container a = make_grown(10, 100);
+  container b = make_grown(10, 40);
+  container c = make_grown(10, 30);
+  a.set_trimmable(true);
+  b.set_trimmable(true);
+  c.set_trimmable(true);
+
+  // The largest waste goes first, until at most the budget is left.
+  EXPECT_EQ(90 * sizeof(element), socow_trim(50 * sizeof(element)));
+  EXPECT_EQ(10, a.capacity());
+  EXPECT_EQ(40, b.capacity());
+  EXPECT_EQ(30, c.capacity());
+
+  EXPECT_EQ(30 * sizeof(element), socow_trim(20 * sizeof(element)));
+  EXPECT_EQ(10, b.capacity());
+  EXPECT_EQ(30, c.capacity());
+}
+
+TEST_F(trim_test, not_copied) {
+  container a = make_grown(10, 100);
+  a.set_trimmable(true);
+  container b = make_grown(10, 100);
+  b = a;
+  container c = a;
+  c.push_back(42);
+  EXPECT_FALSE(b.trimmable());
+  EXPECT_FALSE(c.trimmable());
+
+  a.set_trimmable(false);
+  EXPECT_EQ(0, socow_trim());
+}
+
+TEST_F(trim_test, destroyed) {
+  {
+    container a = make_grown(10, 100);
+    a.set_trimmable(true);
+  }
+  EXPECT_EQ(0, socow_trim());
+}
+
+TEST_F(trim_test, throw) {
+  container a = make_grown(10, 100);
+  container b = make_grown(10, 40);
+  a.set_trimmable(true);
+  b.set_trimmable(true);
+
+  {
+    immutable_guard g(a);
+    element::set_copy_throw_countdown(3);
+    EXPECT_EQ(30 * sizeof(element), socow_trim());
+  }
+  EXPECT_EQ(10, b.capacity());
+  expect_values(b, 10);
+
+  element::set_copy_throw_countdown(0);
+  EXPECT_EQ(90 * sizeof(element), socow_trim());
+}
+
+TEST_F(trim_test, nested) {
+  using inner = socow_vector<int, 2>;
+  socow_vector<inner, 2> outer;
+  outer.reserve(40);
+  for (size_t i = 0; i < 5; ++i) {
+    inner v;
+    v.reserve(30);
+    v.push_back(static_cast<int>(i));
+    outer.push_back(v);
+  }
+  for (size_t i = 0; i < 5; ++i) {
+    outer[i].set_trimmable(true);
+  }
+  outer.set_trimmable(true);
+
+  // The inner vectors are copied out of the outer buffer and the trimmable originals are destroyed.
+  EXPECT_EQ(35 * sizeof(inner), socow_trim());
+  EXPECT_EQ(5, outer.capacity());
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(static_cast<int>(i), as_const(outer)[i][0]);
+  }
+  EXPECT_EQ(0, socow_trim());
+}
+
+#if SOCOW_HAS_PSI
+TEST_F(trim_test, pressure_monitor_missing_file) {
+  EXPECT_THROW(socow_memory_pressure_monitor([] {}, std::chrono::milliseconds(100), std::chrono::seconds(1),
+                                             "/nonexistent/memory.pressure"),
+               std::system_error);
+}
+
+// A regular file accepts the trigger but never reports an event, which checks starting and stopping the thread.
+TEST_F(trim_test, pressure_monitor_stops) {
+  char path[] = "/tmp/socow-pressure-XXXXXX";
+  int fd = ::mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ::close(fd);
+  bool called = false;
+  {
+    socow_memory_pressure_monitor monitor([&called] { called = true; }, std::chrono::milliseconds(100),
+                                          std::chrono::seconds(1), path);
+  }
+  ::unlink(path);
+  EXPECT_FALSE(called);
+}
+
+TEST_F(trim_test, pressure_monitor) {
+  try {
+    socow_memory_pressure_monitor monitor([] { socow_trim(); });
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "PSI is not available: " << e.what();
+  }
+}
+#endif
@@ -0,0 +1,72 @@
+#include "socow-vector.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#if SOCOW_HAS_USDT && __has_include(<elf.h>)
+#include <elf.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+// "provider:name" of every probe in the .note.stapsdt section of a 64-bit ELF file.
+std::vector<std::string> stapsdt_probes(const char* path) {
+  std::ifstream in(path, std::ios::binary);
+  std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::vector<std::string> probes;
+  Elf64_Ehdr header;
+  if (file.size() < sizeof(header) || std::memcmp(file.data(), ELFMAG, SELFMAG) != 0 ||
+      file[EI_CLASS] != ELFCLASS64) {
+    return probes;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  auto section = [&](size_t i) {
+    Elf64_Shdr result;
+    std::memcpy(&result, file.data() + header.e_shoff + i * header.e_shentsize, sizeof(result));
+    return result;
+  };
+  Elf64_Shdr names = section(header.e_shstrndx);
+  for (size_t i = 0; i < header.e_shnum; ++i) {
+    Elf64_Shdr notes = section(i);
+    if (std::strcmp(file.data() + names.sh_offset + notes.sh_name, ".note.stapsdt") != 0) {
+      continue;
+    }
+    for (size_t offset = notes.sh_offset; offset + sizeof(Elf64_Nhdr) <= notes.sh_offset + notes.sh_size;) {
+      Elf64_Nhdr note;
+      std::memcpy(&note, file.data() + offset, sizeof(note));
+      const char* name = file.data() + offset + sizeof(note);
+      const char* desc = name + (note.n_namesz + 3) / 4 * 4;
+      if (note.n_type == 3 && std::strcmp(name, "stapsdt") == 0) {
+        // The probe, base and semaphore addresses come first.
+        const char* provider = desc + 3 * sizeof(Elf64_Addr);
+        probes.push_back(std::string(provider) + ":" + (provider + std::strlen(provider) + 1));
+      }
+      offset = static_cast<size_t>(desc - file.data()) + (note.n_descsz + 3) / 4 * 4;
+    }
+  }
+  return probes;
+}
+
+} // namespace
+
+TEST(usdt_test, probes_in_binary) {
+  std::vector<std::string> probes = stapsdt_probes("/proc/self/exe");
+  for (const char* probe : {"unshare", "spill", "grow", "shrink_to_small", "release"}) {
+    EXPECT_NE(probes.end(), std::find(probes.begin(), probes.end(), std::string("socow_vector:") + probe)) << probe;
+  }
+}
+#elif SOCOW_REQUIRE_USDT
+TEST(usdt_test, probes_in_binary) {
+  FAIL() << "sys/sdt.h (systemtap-sdt-dev) is not available, the probes are compiled out";
+}
+#else
+TEST(usdt_test, probes_in_binary) {
+  GTEST_SKIP() << "sys/sdt.h is not available, the probes are compiled out";
+}
+#endif